@@ -58,6 +58,44 @@ fi
 # Track whether probe ran to show post-probe messages
 probe_done=0
 
+# Live mode (set by xpt-calibrate.sh): xpt-uinputd keeps running and owns
+# SPI. The wizard reads and applies its values over the control socket
+# (get/set/save), streams samples with subscribe and points the GUI tests
+# at the daemon's feed, so nothing reopens or re-probes the panel.
+LIVE="${XPT_CALIBRATE_LIVE:-0}"
+CTL_BIN="$REPO_DIR/build/xpt2046_ctl"
+WIZARD_KEYS="invert_x invert_y swap_xy min_x max_x min_y max_y screen_w screen_h offset_x offset_y poll_us scale_x scale_y deadzone_left deadzone_right deadzone_top deadzone_bottom median_window iir_alpha press_threshold release_threshold max_delta_px tap_max_ms tap_max_move_px drag_start_px"
+live_original=""
+live_feed=""
+if [ "$LIVE" = "1" ] && [ ! -x "$CTL_BIN" ]; then
+    LIVE=0
+fi
+
+ctl() {
+    if [ "$(id -u)" -eq 0 ]; then
+        "$CTL_BIN" "$@"
+    else
+        sudo "$CTL_BIN" "$@"
+    fi
+}
+
+# Push the wizard's current values to the daemon as one config.
+live_apply() {
+    local args=() k out
+    for k in $WIZARD_KEYS; do
+        args+=("$k=${!k}")
+    done
+    out="$(ctl set "${args[@]}" 2>&1)" || { echo "$out" >&2; return 1; }
+}
+
+# Put back the values the daemon ran with before the wizard (not saved).
+live_restore() {
+    if [ "$LIVE" = "1" ] && [ -n "$live_original" ]; then
+        ctl set $live_original >/dev/null 2>&1 || true
+        live_original=""
+    fi
+}
+
 # If we probe SPI device, keep it in-memory and only write it on explicit Save.
 probed_spi_device=""
 
@@ -65,9 +103,9 @@ probed_spi_device=""
 # Always restore cursor on exit; safely handle non-tty and stty errors
 if [ -t 0 ]; then
     orig_stty=$(stty -g)
-    trap 'if [ -t 0 ]; then stty "$orig_stty" 2>/dev/null || stty sane; fi; tput cnorm' EXIT
+    trap 'live_restore; if [ -t 0 ]; then stty "$orig_stty" 2>/dev/null || stty sane; fi; tput cnorm' EXIT
 else
-    trap 'tput cnorm' EXIT
+    trap 'live_restore; tput cnorm' EXIT
 fi
 if [ -f "$HOME/.bash_profile" ]; then
     sed -i '/calibrate.sh/d' "$HOME/.bash_profile"
@@ -94,11 +132,14 @@ while true; do
     esac
 done
 
-echo "Keep your finger at the center of the display, then press ENTER to start the 10-second SPI probe."
-read -r
+if [ "$LIVE" != "1" ]; then
+    echo "Keep your finger at the center of the display, then press ENTER to start the 10-second SPI probe."
+    read -r
+fi
 
-# Optional SPI probe: ask the user to keep a finger at the center for 10s
-if [ -z "$CALIBRATION_RUNNING" ]; then
+# Optional SPI probe: ask the user to keep a finger at the center for 10s.
+# Not needed in live mode: the daemon already found the panel.
+if [ -z "$CALIBRATION_RUNNING" ] && [ "$LIVE" != "1" ]; then
     # Run probe against a temporary config so we never modify an existing saved config.
     PROBE_CONFIG=""
     if command -v mktemp >/dev/null 2>&1; then
@@ -174,7 +215,8 @@ drag_start_px=18
 # Captured SPI device from config (if present)
 spi_device=""
 
-if [ -f "$CONFIG" ]; then
+load_values() {
+    # Reads key=value lines on stdin into the wizard variables.
     while IFS='=' read -r key value; do
         case "$key" in
             invert_x) invert_x=$value;;
@@ -206,7 +248,23 @@ if [ -f "$CONFIG" ]; then
             tap_max_move_px) tap_max_move_px=$value;;
             drag_start_px) drag_start_px=$value;;
         esac
-    done < "$CONFIG"
+    done
+}
+
+if [ -f "$CONFIG" ]; then
+    load_values < "$CONFIG"
+fi
+
+# In live mode the daemon's running values win, and are kept to put back
+# if the wizard exits without saving.
+if [ "$LIVE" = "1" ]; then
+    live_original="$(ctl get $WIZARD_KEYS 2>/dev/null | tr '\n' ' ')" || live_original=""
+    if [ -n "$live_original" ]; then
+        load_values < <(printf "%s\n" $live_original)
+        live_feed="$(ctl get feed_shm 2>/dev/null | sed -n 's/^feed_shm=//p')" || live_feed=""
+    else
+        LIVE=0
+    fi
 fi
 
 # If we probed a spi_device and the saved config doesn't already have one, use the probed value.
@@ -252,7 +310,7 @@ run_with_env() {
         XPT_PRESS_THRESHOLD="$press_threshold" XPT_RELEASE_THRESHOLD="$release_threshold" \
         XPT_MAX_DELTA_PX="$max_delta_px" \
         XPT_TAP_MAX_MS="$tap_max_ms" XPT_TAP_MAX_MOVE_PX="$tap_max_move_px" XPT_DRAG_START_PX="$drag_start_px" \
-        TOUCH_CONFIG_PATH="$CONFIG" \
+        TOUCH_CONFIG_PATH="$CONFIG" XPT_GUI_FEED="$live_feed" \
         "$@"
 }
 
@@ -274,7 +332,7 @@ run_with_env_bg() {
             XPT_PRESS_THRESHOLD="$press_threshold" XPT_RELEASE_THRESHOLD="$release_threshold" \
             XPT_MAX_DELTA_PX="$max_delta_px" \
             XPT_TAP_MAX_MS="$tap_max_ms" XPT_TAP_MAX_MOVE_PX="$tap_max_move_px" XPT_DRAG_START_PX="$drag_start_px" \
-            TOUCH_CONFIG_PATH="$CONFIG" \
+            TOUCH_CONFIG_PATH="$CONFIG" XPT_GUI_FEED="$live_feed" \
             "$@" &
     else
         run_with_env "$@" &
@@ -415,7 +473,7 @@ advanced_screen() {
                 9) label="deadzone_right: $deadzone_right (0..1000)";;
                 10) label="deadzone_top: $deadzone_top (0..1000)";;
                 11) label="deadzone_bottom: $deadzone_bottom (0..1000)";;
-                12) label="median_window: $median_window (0|3|5)";;
+                12) label="median_window: $median_window (0|3|5|7|9)";;
                 13) label="iir_alpha: $iir_alpha (0..1)";;
                 14) label="press_threshold: $press_threshold (0..4095)";;
                 15) label="release_threshold: $release_threshold (0..press)";;
@@ -471,7 +529,7 @@ advanced_screen() {
                 9) read -p "Enter deadzone_right: " deadzone_right;;
                 10) read -p "Enter deadzone_top: " deadzone_top;;
                 11) read -p "Enter deadzone_bottom: " deadzone_bottom;;
-                12) read -p "Enter median_window (0/3/5): " median_window;;
+                12) read -p "Enter median_window (0/3/5/7/9): " median_window;;
                 13) read -p "Enter iir_alpha (0..1): " iir_alpha;;
                 14) read -p "Enter press_threshold (0..4095): " press_threshold;;
                 15) read -p "Enter release_threshold (0..press): " release_threshold;;
@@ -518,6 +576,15 @@ advanced_screen() {
                         }
                         trap 'cleanup_adv_raw 130' INT TERM
 
+                        if [ "$LIVE" = "1" ]; then
+                            echo "Filtered samples from the running daemon; press Enter to return."
+                            if ! { live_apply && ctl subscribe filtered; }; then
+                                echo "Press Enter to return."
+                                read -r
+                            fi
+                            cleanup_adv_raw 0
+                        fi
+
                         if [ -x "$REPO_DIR/build/xpt2046_calibrator" ]; then
                             run_with_env "$REPO_DIR/build/xpt2046_calibrator" --advanced_raw --invert_x "$invert_x" --invert_y "$invert_y" --swap_xy "$swap_xy" &
                             pid=$!
@@ -560,7 +627,14 @@ advanced_screen() {
                     if [ -x "$REPO_DIR/build/xpt_advanced_gui_sdl2" ]; then
                         bin="$REPO_DIR/build/xpt_advanced_gui_sdl2"
                     fi
-                    if [ -n "$bin" ]; then
+                    if [ "$LIVE" = "1" ]; then
+                        live_apply || true
+                    fi
+                    if [ "$LIVE" = "1" ] && [ -z "$live_feed" ]; then
+                        echo "The running daemon publishes no sample feed (feed_shm is empty)."
+                        echo "Press Enter to return."
+                        read -r
+                    elif [ -n "$bin" ]; then
                         if [ -n "$DISPLAY" ]; then
                             run_with_env SDL_VIDEO_X11_XSHM=0 "$bin"
                         else
@@ -652,6 +726,15 @@ handle_action() {
                 }
                 trap 'cleanup_raw 130' INT TERM
 
+                if [ "$LIVE" = "1" ]; then
+                    echo "Raw samples from the running daemon; press Enter to return."
+                    if ! { live_apply && ctl subscribe raw; }; then
+                        echo "Press Enter to return."
+                        read -r
+                    fi
+                    cleanup_raw 0
+                fi
+
                 if [ -x "$REPO_DIR/build/xpt2046_calibrator" ]; then
                     run_with_env "$REPO_DIR/build/xpt2046_calibrator" --invert_x "$invert_x" --invert_y "$invert_y" --swap_xy "$swap_xy" &
                     pid=$!
@@ -706,7 +789,14 @@ handle_action() {
                 bin="$REPO_DIR/build/xpt_basic_gui_sdl2"
             fi
 
-            if [ -n "$bin" ]; then
+            if [ "$LIVE" = "1" ]; then
+                live_apply || true
+            fi
+            if [ "$LIVE" = "1" ] && [ -z "$live_feed" ]; then
+                echo "The running daemon publishes no sample feed (feed_shm is empty)."
+                echo "Press Enter to return."
+                read -r
+            elif [ -n "$bin" ]; then
                 if [ -n "$DISPLAY" ]; then
                     run_with_env SDL_VIDEO_X11_XSHM=0 "$bin"
                 else
@@ -725,40 +815,59 @@ handle_action() {
             tput clear
             ;;
         10)
-            echo "invert_x=$invert_x" > "$CONFIG"
-            echo "invert_y=$invert_y" >> "$CONFIG"
-            echo "swap_xy=$swap_xy" >> "$CONFIG"
-            echo "min_x=$min_x" >> "$CONFIG"
-            echo "max_x=$max_x" >> "$CONFIG"
-            echo "min_y=$min_y" >> "$CONFIG"
-            echo "max_y=$max_y" >> "$CONFIG"
-
-            echo "screen_w=$screen_w" >> "$CONFIG"
-            echo "screen_h=$screen_h" >> "$CONFIG"
-            echo "offset_x=$offset_x" >> "$CONFIG"
-            echo "offset_y=$offset_y" >> "$CONFIG"
-            echo "poll_us=$poll_us" >> "$CONFIG"
-            echo "scale_x=$scale_x" >> "$CONFIG"
-            echo "scale_y=$scale_y" >> "$CONFIG"
-            echo "deadzone_left=$deadzone_left" >> "$CONFIG"
-            echo "deadzone_right=$deadzone_right" >> "$CONFIG"
-            echo "deadzone_top=$deadzone_top" >> "$CONFIG"
-            echo "deadzone_bottom=$deadzone_bottom" >> "$CONFIG"
-            echo "median_window=$median_window" >> "$CONFIG"
-            echo "iir_alpha=$iir_alpha" >> "$CONFIG"
-            echo "press_threshold=$press_threshold" >> "$CONFIG"
-            echo "release_threshold=$release_threshold" >> "$CONFIG"
-            echo "max_delta_px=$max_delta_px" >> "$CONFIG"
-            echo "tap_max_ms=$tap_max_ms" >> "$CONFIG"
-            echo "tap_max_move_px=$tap_max_move_px" >> "$CONFIG"
-            echo "drag_start_px=$drag_start_px" >> "$CONFIG"
+            # Keep keys this wizard does not manage (e.g. burst_xy) so saving does not drop them.
+            extra_cfg=""
+            if [ -f "$CONFIG" ]; then
+                extra_cfg="$(grep -vE '^(invert_x|invert_y|swap_xy|min_x|max_x|min_y|max_y|screen_w|screen_h|offset_x|offset_y|poll_us|scale_x|scale_y|deadzone_left|deadzone_right|deadzone_top|deadzone_bottom|median_window|iir_alpha|press_threshold|release_threshold|max_delta_px|tap_max_ms|tap_max_move_px|drag_start_px)=|^$' "$CONFIG" || true)"
+            fi
+            # Write a copy and rename it into place: the uinput daemon reloads on change
+            # and must never read a half-written config.
+            echo "invert_x=$invert_x" > "$CONFIG.tmp"
+            echo "invert_y=$invert_y" >> "$CONFIG.tmp"
+            echo "swap_xy=$swap_xy" >> "$CONFIG.tmp"
+            echo "min_x=$min_x" >> "$CONFIG.tmp"
+            echo "max_x=$max_x" >> "$CONFIG.tmp"
+            echo "min_y=$min_y" >> "$CONFIG.tmp"
+            echo "max_y=$max_y" >> "$CONFIG.tmp"
+
+            echo "screen_w=$screen_w" >> "$CONFIG.tmp"
+            echo "screen_h=$screen_h" >> "$CONFIG.tmp"
+            echo "offset_x=$offset_x" >> "$CONFIG.tmp"
+            echo "offset_y=$offset_y" >> "$CONFIG.tmp"
+            echo "poll_us=$poll_us" >> "$CONFIG.tmp"
+            echo "scale_x=$scale_x" >> "$CONFIG.tmp"
+            echo "scale_y=$scale_y" >> "$CONFIG.tmp"
+            echo "deadzone_left=$deadzone_left" >> "$CONFIG.tmp"
+            echo "deadzone_right=$deadzone_right" >> "$CONFIG.tmp"
+            echo "deadzone_top=$deadzone_top" >> "$CONFIG.tmp"
+            echo "deadzone_bottom=$deadzone_bottom" >> "$CONFIG.tmp"
+            echo "median_window=$median_window" >> "$CONFIG.tmp"
+            echo "iir_alpha=$iir_alpha" >> "$CONFIG.tmp"
+            echo "press_threshold=$press_threshold" >> "$CONFIG.tmp"
+            echo "release_threshold=$release_threshold" >> "$CONFIG.tmp"
+            echo "max_delta_px=$max_delta_px" >> "$CONFIG.tmp"
+            echo "tap_max_ms=$tap_max_ms" >> "$CONFIG.tmp"
+            echo "tap_max_move_px=$tap_max_move_px" >> "$CONFIG.tmp"
+            echo "drag_start_px=$drag_start_px" >> "$CONFIG.tmp"
+            if [ -n "$extra_cfg" ]; then
+                printf "%s\n" "$extra_cfg" >> "$CONFIG.tmp"
+            fi
+            mv -f "$CONFIG.tmp" "$CONFIG"
             # (Intentionally no message about the repo-local config path.)
 
-            # Also persist for system services (e.g., xpt-uinputd) which typically run as root.
-            if command -v sudo >/dev/null 2>&1; then
+            # In live mode the daemon applies the values and writes them to its own
+            # config file; otherwise persist for system services (e.g., xpt-uinputd)
+            # which typically run as root.
+            if [ "$LIVE" = "1" ]; then
+                if live_apply && ctl save; then
+                    live_original=""
+                else
+                    echo "The running daemon did not take the values; they are only in $CONFIG."
+                fi
+            elif command -v sudo >/dev/null 2>&1; then
                 sudo mkdir -p "$(dirname "$SYSTEM_CONFIG")" >/dev/null 2>&1 || true
-                sudo cp "$CONFIG" "$SYSTEM_CONFIG" >/dev/null 2>&1 || true
-                sudo chmod 0644 "$SYSTEM_CONFIG" >/dev/null 2>&1 || true
+                sudo install -m 0644 "$CONFIG" "$SYSTEM_CONFIG.tmp" >/dev/null 2>&1 && \
+                    sudo mv -f "$SYSTEM_CONFIG.tmp" "$SYSTEM_CONFIG" >/dev/null 2>&1 || true
                 if [[ -f "$SYSTEM_CONFIG" ]]; then
                     echo "Saved to: $SYSTEM_CONFIG"
                 fi
@@ -767,6 +876,7 @@ handle_action() {
             exit 0
             ;;
         11)
+            live_restore
             echo "Exit without saving: no changes were written."
             exit 0
             ;;
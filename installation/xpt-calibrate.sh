@@ -1,5 +1,7 @@
 #!/bin/bash
 # xpt-calibrate.sh - Stop configured GUI service, run calibration wizard, then restore GUI service.
+# A running xpt-uinputd that answers on its control socket keeps running: the
+# wizard then drives it through build/xpt2046_ctl instead of reopening SPI.
 #
 # Expected config file:
 #   /etc/xpt2046/gui.service   (single line: <service-name>.service)
@@ -46,12 +48,22 @@ if [[ "$have_systemctl" -eq 1 ]]; then
   fi
 fi
 
+# Live mode: the daemon is up and its control socket answers.
+ctl_bin="$REPO_DIR/build/xpt2046_ctl"
+live=0
+if [[ "$have_uinput" -eq 1 && -x "$ctl_bin" ]] && systemctl is-active --quiet "$uinput_service" 2>/dev/null; then
+  if sudo "$ctl_bin" stats >/dev/null 2>&1; then
+    live=1
+  fi
+fi
+
+uinput_stopped=0
 restored=0
 restore_gui() {
   if [[ "$restored" -eq 1 ]]; then
     return 0
   fi
-  if [[ "$have_uinput" -eq 1 ]]; then
+  if [[ "$uinput_stopped" -eq 1 ]]; then
     sudo systemctl start "$uinput_service" >/dev/null 2>&1 || true
   fi
   if [[ -n "$chosen_service" && "$have_systemctl" -eq 1 ]]; then
@@ -69,12 +81,15 @@ else
   echo "Tip: configure with: bash ./configure_gui_service.sh"
 fi
 
-if [[ "$have_uinput" -eq 1 ]]; then
+if [[ "$live" -eq 1 ]]; then
+  echo "uinput service is running: calibrating through its control socket."
+elif [[ "$have_uinput" -eq 1 ]]; then
   echo "Stopping uinput service: $uinput_service"
   sudo systemctl stop "$uinput_service" || true
+  uinput_stopped=1
 fi
 
-bash "$SCRIPT_DIR/calibrate.sh"
+XPT_CALIBRATE_LIVE="$live" bash "$SCRIPT_DIR/calibrate.sh"
 status=$?
 
 restore_gui
@@ -1,94 +1,59 @@
 #include <SDL.h>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 #include <vector>
 #include <fstream>
-#include <sstream>
-#include <regex>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
 
-static std::string get_exe_dir() {
-	char buf[4096];
-	ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
-	if (n <= 0) return std::string();
-	buf[n] = '\0';
-	std::string path(buf);
-	size_t pos = path.find_last_of('/');
-	if (pos == std::string::npos) return std::string();
-	return path.substr(0, pos);
-}
-
-static std::string find_config_path() {
-	const char* envPath = getenv("TOUCH_CONFIG_PATH");
-	if (envPath && *envPath) {
-		std::ifstream f(envPath);
-		if (f.good()) return std::string(envPath);
-	}
-
-	std::vector<std::string> candidates;
-	candidates.push_back("/etc/xpt2046/touch_config.txt");
-	candidates.push_back("installation/touch_config.txt");
-	candidates.push_back("touch_config.txt");
-	std::string exeDir = get_exe_dir();
-	if (!exeDir.empty()) {
-		candidates.push_back(exeDir + "/installation/touch_config.txt");
-		candidates.push_back(exeDir + "/../installation/touch_config.txt");
-	}
-	for (const auto& p : candidates) {
-		std::ifstream f(p);
-		if (f.good()) return p;
-	}
-	return std::string();
-}
+#include "xpt2046_config.h"
+#include "xpt2046_feed.h"
+#include "xpt2046_mapping.h"
 
 struct Config {
-	int min_x = 0, max_x = 4095, min_y = 0, max_y = 4095;
 	int screen_w = 800, screen_h = 480;
 	int deadzone_left = 0, deadzone_right = 0, deadzone_top = 0, deadzone_bottom = 0;
+	MeshParams mesh;
+	// Swap/invert + min/max only, as the calibrator maps before the advanced
+	// pipeline; drives the gray pointer.
+	MappingParams raw;
 };
 
-static void load_config(const std::string& cfgPath, Config& cfg) {
-	if (cfgPath.empty()) return;
-	std::ifstream in(cfgPath);
-	if (!in.good()) return;
-
-	std::string line;
-	while (std::getline(in, line)) {
-		if (line.empty() || line[0] == '#') continue;
-		auto pos = line.find('=');
-		if (pos == std::string::npos) continue;
-		std::string key = line.substr(0, pos);
-		std::string val = line.substr(pos + 1);
-		auto ltrim = [](std::string& s) { s.erase(0, s.find_first_not_of(" \t")); };
-		auto rtrim = [](std::string& s) { s.erase(s.find_last_not_of(" \t") + 1); };
-		ltrim(key);
-		rtrim(key);
-		ltrim(val);
-		rtrim(val);
-		int iv = std::atoi(val.c_str());
-
-		if (key == "min_x") cfg.min_x = iv;
-		else if (key == "max_x") cfg.max_x = iv;
-		else if (key == "min_y") cfg.min_y = iv;
-		else if (key == "max_y") cfg.max_y = iv;
-		else if (key == "screen_w") cfg.screen_w = iv;
-		else if (key == "screen_h") cfg.screen_h = iv;
-		else if (key == "deadzone_left") cfg.deadzone_left = iv;
-		else if (key == "deadzone_right") cfg.deadzone_right = iv;
-		else if (key == "deadzone_top") cfg.deadzone_top = iv;
-		else if (key == "deadzone_bottom") cfg.deadzone_bottom = iv;
+// Same file and XPT_* overrides as the daemon, reduced to what is drawn here.
+static void load_gui_config(Config& cfg, std::string& cfgPath) {
+	int invert_x = 0, invert_y = 0, swap_xy = 0;
+	int min_x = 0, max_x = 4095, min_y = 0, max_y = 4095;
+	AdvancedParams adv;
+	std::string spi_device;
+	load_config(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, cfgPath, spi_device);
+	apply_env_overrides(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, spi_device);
+	sanitize_adv(adv);
+
+	cfg.screen_w = adv.screen_w;
+	cfg.screen_h = adv.screen_h;
+	cfg.deadzone_left = adv.deadzone_left;
+	cfg.deadzone_right = adv.deadzone_right;
+	cfg.deadzone_top = adv.deadzone_top;
+	cfg.deadzone_bottom = adv.deadzone_bottom;
+	if (!adv.mesh.empty() && !parse_mesh(adv.mesh, cfg.mesh)) {
+		std::fprintf(stderr, "[WARN] Ignoring malformed mesh in %s\n", cfgPath.empty() ? "XPT_MESH" : cfgPath.c_str());
 	}
 
-	if (cfg.max_x <= cfg.min_x) cfg.max_x = cfg.min_x + 1;
-	if (cfg.max_y <= cfg.min_y) cfg.max_y = cfg.min_y + 1;
-	if (cfg.screen_w < 1) cfg.screen_w = 1;
-	if (cfg.screen_h < 1) cfg.screen_h = 1;
+	cfg.raw.invert_x = invert_x;
+	cfg.raw.invert_y = invert_y;
+	cfg.raw.swap_xy = swap_xy;
+	cfg.raw.min_x = min_x;
+	cfg.raw.max_x = max_x;
+	cfg.raw.min_y = min_y;
+	cfg.raw.max_y = max_y;
+	cfg.raw.screen_w = adv.screen_w;
+	cfg.raw.screen_h = adv.screen_h;
 }
 
 static std::string find_calibrator_binary() {
@@ -103,34 +68,6 @@ static std::string find_calibrator_binary() {
 	return std::string();
 }
 
-static int clamp_i(int v, int lo, int hi) {
-	if (v < lo) return lo;
-	if (v > hi) return hi;
-	return v;
-}
-
-static std::pair<int, int> scale_raw_to_screen(int raw_x, int raw_y, const Config& cfg, int invert_x, int invert_y, int swap_xy) {
-	int x = raw_x;
-	int y = raw_y;
-	if (swap_xy) {
-		int tmp = x;
-		x = y;
-		y = tmp;
-	}
-	if (invert_x) x = 4095 - x;
-	if (invert_y) y = 4095 - y;
-	x = clamp_i(x, cfg.min_x, cfg.max_x);
-	y = clamp_i(y, cfg.min_y, cfg.max_y);
-
-	int sx = (int)((x - cfg.min_x) * (cfg.screen_w / (double)(cfg.max_x - cfg.min_x)));
-	int sy = (int)((y - cfg.min_y) * (cfg.screen_h / (double)(cfg.max_y - cfg.min_y)));
-	if (sx < 0) sx = 0;
-	if (sy < 0) sy = 0;
-	if (sx >= cfg.screen_w) sx = cfg.screen_w - 1;
-	if (sy >= cfg.screen_h) sy = cfg.screen_h - 1;
-	return {sx, sy};
-}
-
 static void draw_pointer(SDL_Renderer* r, int x, int y, SDL_Color col, SDL_Color border) {
 	SDL_Rect dot{x - 6, y - 6, 12, 12};
 	SDL_SetRenderDrawColor(r, col.r, col.g, col.b, 255);
@@ -144,6 +81,46 @@ static void draw_rect_outline(SDL_Renderer* r, SDL_Rect rect, SDL_Color col) {
 	SDL_RenderDrawRect(r, &rect);
 }
 
+// Where mesh node (i, j) currently pulls touches to: its ideal position plus
+// the stored offset.
+static void mesh_node_displaced(const Config& cfg, int i, int j, int& x, int& y) {
+	mesh_node_position(cfg.mesh.size, cfg.screen_w, cfg.screen_h, i, j, x, y);
+	const size_t k = (size_t)(j * cfg.mesh.size + i) * 2;
+	x += (int)(cfg.mesh.offsets[k] + (cfg.mesh.offsets[k] < 0 ? -0.5f : 0.5f));
+	y += (int)(cfg.mesh.offsets[k + 1] + (cfg.mesh.offsets[k + 1] < 0 ? -0.5f : 0.5f));
+}
+
+// Ideal grid in gray, corrected grid in blue, selected node in red.
+static void draw_mesh(SDL_Renderer* r, const Config& cfg, int selected, SDL_Color ideal, SDL_Color moved, SDL_Color sel) {
+	const int n = cfg.mesh.size;
+	for (int j = 0; j < n; ++j) {
+		for (int i = 0; i < n; ++i) {
+			int x = 0, y = 0, dx = 0, dy = 0;
+			mesh_node_position(n, cfg.screen_w, cfg.screen_h, i, j, x, y);
+			mesh_node_displaced(cfg, i, j, dx, dy);
+			SDL_SetRenderDrawColor(r, ideal.r, ideal.g, ideal.b, 255);
+			SDL_RenderDrawLine(r, x - 3, y, x + 3, y);
+			SDL_RenderDrawLine(r, x, y - 3, x, y + 3);
+			SDL_SetRenderDrawColor(r, moved.r, moved.g, moved.b, 255);
+			SDL_RenderDrawLine(r, x, y, dx, dy);
+			if (i + 1 < n) {
+				int nx = 0, ny = 0;
+				mesh_node_displaced(cfg, i + 1, j, nx, ny);
+				SDL_RenderDrawLine(r, dx, dy, nx, ny);
+			}
+			if (j + 1 < n) {
+				int nx = 0, ny = 0;
+				mesh_node_displaced(cfg, i, j + 1, nx, ny);
+				SDL_RenderDrawLine(r, dx, dy, nx, ny);
+			}
+			SDL_Color c = (j * n + i == selected) ? sel : moved;
+			SDL_Rect dot{dx - 3, dy - 3, 7, 7};
+			SDL_SetRenderDrawColor(r, c.r, c.g, c.b, 255);
+			SDL_RenderFillRect(r, &dot);
+		}
+	}
+}
+
 // Minimal 5x7 font for digits + a few uppercase letters used in the UI.
 static const unsigned char* glyph_5x7(char c) {
 	// Each glyph is 7 rows, 5 bits per row (MSB on the left).
@@ -164,11 +141,15 @@ static const unsigned char* glyph_5x7(char c) {
 
 	static unsigned char A[7] = {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11};
 	static unsigned char D[7] = {0x1E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1E};
+	static unsigned char E[7] = {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F};
 	static unsigned char G[7] = {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0E};
+	static unsigned char H[7] = {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11};
+	static unsigned char M[7] = {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11};
 	static unsigned char N[7] = {0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x11};
 	static unsigned char O[7] = {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E};
 	static unsigned char P[7] = {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10};
 	static unsigned char R[7] = {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11};
+	static unsigned char S[7] = {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E};
 	static unsigned char T[7] = {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04};
 	static unsigned char U[7] = {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E};
 	static unsigned char W[7] = {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A};
@@ -197,11 +178,15 @@ static const unsigned char* glyph_5x7(char c) {
 	switch (c) {
 		case 'A': return A;
 		case 'D': return D;
+		case 'E': return E;
 		case 'G': return G;
+		case 'H': return H;
+		case 'M': return M;
 		case 'N': return N;
 		case 'O': return O;
 		case 'P': return P;
 		case 'R': return R;
+		case 'S': return S;
 		case 'T': return T;
 		case 'U': return U;
 		case 'W': return W;
@@ -235,33 +220,10 @@ int main(int argc, char** argv) {
 	(void)argv;
 
 	Config cfg;
-	std::string cfgPath = find_config_path();
-	load_config(cfgPath, cfg);
-
-	// These come from Basic settings / wizard and must affect the gray pointer too.
-	int invert_x = 0;
-	int invert_y = 0;
-	int swap_xy = 0;
-	if (const char* v = getenv("XPT_INVERT_X")) { if (*v) invert_x = std::atoi(v); }
-	if (const char* v = getenv("XPT_INVERT_Y")) { if (*v) invert_y = std::atoi(v); }
-	if (const char* v = getenv("XPT_SWAP_XY")) { if (*v) swap_xy = std::atoi(v); }
-
-	// Allow env overrides for live testing
-	if (const char* v = getenv("XPT_MIN_X")) { if (*v) cfg.min_x = std::atoi(v); }
-	if (const char* v = getenv("XPT_MAX_X")) { if (*v) cfg.max_x = std::atoi(v); }
-	if (const char* v = getenv("XPT_MIN_Y")) { if (*v) cfg.min_y = std::atoi(v); }
-	if (const char* v = getenv("XPT_MAX_Y")) { if (*v) cfg.max_y = std::atoi(v); }
-	if (const char* v = getenv("XPT_SCREEN_W")) { if (*v) cfg.screen_w = std::atoi(v); }
-	if (const char* v = getenv("XPT_SCREEN_H")) { if (*v) cfg.screen_h = std::atoi(v); }
-	if (const char* v = getenv("XPT_DEADZONE_LEFT")) { if (*v) cfg.deadzone_left = std::atoi(v); }
-	if (const char* v = getenv("XPT_DEADZONE_RIGHT")) { if (*v) cfg.deadzone_right = std::atoi(v); }
-	if (const char* v = getenv("XPT_DEADZONE_TOP")) { if (*v) cfg.deadzone_top = std::atoi(v); }
-	if (const char* v = getenv("XPT_DEADZONE_BOTTOM")) { if (*v) cfg.deadzone_bottom = std::atoi(v); }
-
-	if (cfg.max_x <= cfg.min_x) cfg.max_x = cfg.min_x + 1;
-	if (cfg.max_y <= cfg.min_y) cfg.max_y = cfg.min_y + 1;
-	if (cfg.screen_w < 1) cfg.screen_w = 1;
-	if (cfg.screen_h < 1) cfg.screen_h = 1;
+	std::string cfgPath;
+	load_gui_config(cfg, cfgPath);
+	ScreenMapper raw_mapper;
+	raw_mapper.build(cfg.raw);
 
 	const char* disp = getenv("DISPLAY");
 	if (disp && *disp) setenv("SDL_VIDEO_X11_XSHM", "0", 0);
@@ -293,8 +255,12 @@ int main(int argc, char** argv) {
 	SDL_Color BLUE{66, 135, 245, 255};
 	SDL_Color GREEN{48, 173, 86, 255};
 
-	std::string calibrator = find_calibrator_binary();
-	if (calibrator.empty()) {
+	// XPT_GUI_FEED names the feed of a running daemon (calibrate.sh sets it
+	// when the daemon is live); no calibrator child reopens SPI then.
+	const char* liveFeed = getenv("XPT_GUI_FEED");
+	const bool live = liveFeed && *liveFeed;
+	std::string calibrator = live ? std::string() : find_calibrator_binary();
+	if (!live && calibrator.empty()) {
 		std::fprintf(stderr, "[ERROR] xpt2046_calibrator binary not found. Build it first.\n");
 		SDL_DestroyRenderer(ren);
 		SDL_DestroyWindow(win);
@@ -302,21 +268,15 @@ int main(int argc, char** argv) {
 		return 1;
 	}
 
-	int pipefd[2];
-	if (pipe(pipefd) != 0) {
-		std::fprintf(stderr, "[ERROR] pipe() failed\n");
-		SDL_DestroyRenderer(ren);
-		SDL_DestroyWindow(win);
-		SDL_Quit();
-		return 1;
-	}
-
-	pid_t pid = fork();
+	// The calibrator publishes every frame into a shared-memory feed of our
+	// own; only its warnings (stderr) are shown.
+	const std::string feedPath = live ? std::string(liveFeed) : "/dev/shm/xpt2046-gui-" + std::to_string(getpid());
+	pid_t pid = live ? -1 : fork();
 	if (pid == 0) {
-		close(pipefd[0]);
-		dup2(pipefd[1], STDOUT_FILENO);
-		dup2(pipefd[1], STDERR_FILENO);
+		int devnull = open("/dev/null", O_WRONLY);
+		if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
 		setenv("CALIBRATION_RUNNING", "1", 1);
+		setenv("XPT_FEED_SHM", feedPath.c_str(), 1);
 		if (!cfgPath.empty()) setenv("TOUCH_CONFIG_PATH", cfgPath.c_str(), 1);
 
 		const char* ix = getenv("XPT_INVERT_X");
@@ -335,16 +295,7 @@ int main(int argc, char** argv) {
 		_exit(127);
 	}
 
-	close(pipefd[1]);
-	FILE* pipeIn = fdopen(pipefd[0], "r");
-	int pipe_fd = fileno(pipeIn);
-	int flags = fcntl(pipe_fd, F_GETFL, 0);
-	fcntl(pipe_fd, F_SETFL, flags | O_NONBLOCK);
-
-	char buf[2048];
-
-	std::regex re_spi(R"(^\[SPI\]\s+XPT2046\s+X:\s*(\d+)\s+Y:\s*(\d+)\s+\(raw X:\s*(\d+)\s+raw Y:\s*(\d+)(?:\s+SX:\s*(\d+)\s+SY:\s*(\d+))?(?:\s+Z:\s*(\d+))?(?:\s+DOWN:\s*(\d+))?.*\))");
-	std::regex re_gesture(R"(^\[GESTURE\]\s+(.+)$)");
+	FeedReader feed;
 
 	int out_x = cfg.screen_w / 2, out_y = cfg.screen_h / 2;
 	int raw_x = 0, raw_y = 0;
@@ -352,6 +303,13 @@ int main(int argc, char** argv) {
 	bool down = false;
 	std::string last_gesture;
 
+	// Mesh editor: m shows the grid (creating a flat 5x5 one if none is
+	// configured), Tab or a click selects a node, arrows nudge it (Shift = 5 px),
+	// 0 resets it, s writes mesh= to the config. The calibrator child keeps the
+	// mesh it started with, so the red pointer follows edits after a restart.
+	bool show_mesh = false;
+	int mesh_sel = 0;
+
 	bool running = true;
 	while (running) {
 		SDL_Event e;
@@ -360,47 +318,66 @@ int main(int argc, char** argv) {
 			if (e.type == SDL_KEYDOWN) {
 				SDL_Keycode k = e.key.keysym.sym;
 				if (k == SDLK_ESCAPE || k == SDLK_q) running = false;
+				if (k == SDLK_m) {
+					show_mesh = !show_mesh;
+					if (show_mesh && cfg.mesh.size == 0) {
+						cfg.mesh.size = 5;
+						cfg.mesh.offsets.assign(5 * 5 * 2, 0.0f);
+						mesh_sel = 0;
+					}
+				}
+				if (show_mesh && cfg.mesh.size > 0) {
+					const int nodes = cfg.mesh.size * cfg.mesh.size;
+					const float step = (e.key.keysym.mod & KMOD_SHIFT) ? 5.0f : 1.0f;
+					float* d = &cfg.mesh.offsets[(size_t)mesh_sel * 2];
+					if (k == SDLK_TAB) mesh_sel = (mesh_sel + 1) % nodes;
+					else if (k == SDLK_LEFT) d[0] -= step;
+					else if (k == SDLK_RIGHT) d[0] += step;
+					else if (k == SDLK_UP) d[1] -= step;
+					else if (k == SDLK_DOWN) d[1] += step;
+					else if (k == SDLK_0) d[0] = d[1] = 0.0f;
+					else if (k == SDLK_s) {
+						const std::string value = format_mesh(cfg.mesh);
+						if (update_config_key(cfgPath, "mesh", value)) {
+							std::fprintf(stderr, "[CONFIG] Saved mesh=%s to %s\n", value.c_str(), cfgPath.c_str());
+						} else {
+							std::fprintf(stderr, "[ERROR] Cannot save mesh: no writable config file\n");
+						}
+					}
+					d[0] = std::max(-256.0f, std::min(256.0f, d[0]));
+					d[1] = std::max(-256.0f, std::min(256.0f, d[1]));
+				}
 			}
-		}
-
-		ssize_t n = read(pipe_fd, buf, sizeof(buf) - 1);
-		if (n > 0) {
-			buf[n] = '\0';
-			std::istringstream iss{std::string(buf)};
-			std::string line;
-			while (std::getline(iss, line)) {
-				std::smatch m;
-				if (std::regex_search(line, m, re_spi)) {
-					int x_raw_axis = std::atoi(m[1].str().c_str());
-					int y_raw_axis = std::atoi(m[2].str().c_str());
-					raw_x = std::atoi(m[3].str().c_str());
-					raw_y = std::atoi(m[4].str().c_str());
-					int sx = (m.size() > 5 && m[5].matched) ? std::atoi(m[5].str().c_str()) : -1;
-					int sy = (m.size() > 6 && m[6].matched) ? std::atoi(m[6].str().c_str()) : -1;
-					pressure = (m.size() > 7 && m[7].matched) ? std::atoi(m[7].str().c_str()) : 0;
-					int down_i = (m.size() > 8 && m[8].matched) ? std::atoi(m[8].str().c_str()) : -1;
-					if (down_i == 0 || down_i == 1) down = (down_i == 1);
-
-					if (sx >= 0 && sy >= 0) {
-						out_x = sx;
-						out_y = sy;
-					} else {
-						// Fallback: map raw-axis X/Y to screen (no advanced pipeline).
-						auto p = scale_raw_to_screen(x_raw_axis, y_raw_axis, cfg, invert_x, invert_y, swap_xy);
-						out_x = p.first;
-						out_y = p.second;
+			if (e.type == SDL_MOUSEBUTTONDOWN && show_mesh && cfg.mesh.size > 0) {
+				int best = 0;
+				long best_d2 = -1;
+				for (int j = 0; j < cfg.mesh.size; ++j) {
+					for (int i = 0; i < cfg.mesh.size; ++i) {
+						int x = 0, y = 0;
+						mesh_node_displaced(cfg, i, j, x, y);
+						const long d2 = (long)(x - e.button.x) * (x - e.button.x) + (long)(y - e.button.y) * (y - e.button.y);
+						if (best_d2 < 0 || d2 < best_d2) {
+							best_d2 = d2;
+							best = j * cfg.mesh.size + i;
+						}
 					}
-
-					if (out_x < 0) out_x = 0;
-					if (out_y < 0) out_y = 0;
-					if (out_x >= cfg.screen_w) out_x = cfg.screen_w - 1;
-					if (out_y >= cfg.screen_h) out_y = cfg.screen_h - 1;
-				} else if (std::regex_search(line, m, re_gesture)) {
-					last_gesture = m[1].str();
 				}
+				mesh_sel = best;
 			}
 		}
 
+		if (!feed.is_open()) feed.open(feedPath); // once the calibrator created it
+		FeedFrame f;
+		if (feed.latest(f)) {
+			raw_x = f.raw_x;
+			raw_y = f.raw_y;
+			pressure = f.pressure;
+			down = f.down != 0;
+			out_x = clamp_val(f.out_x, 0, cfg.screen_w - 1);
+			out_y = clamp_val(f.out_y, 0, cfg.screen_h - 1);
+			if (f.gestures > 0) last_gesture.assign(f.gesture, strnlen(f.gesture, sizeof(f.gesture)));
+		}
+
 		SDL_SetRenderDrawColor(ren, 245, 245, 245, 255);
 		SDL_RenderClear(ren);
 
@@ -414,6 +391,8 @@ int main(int argc, char** argv) {
 		if (dz.h < 1) dz.h = 1;
 		draw_rect_outline(ren, dz, BLUE);
 
+		if (show_mesh && cfg.mesh.size > 0) draw_mesh(ren, cfg, mesh_sel, GRAY, BLUE, RED);
+
 		// Pressure bar
 		int bar_w = (int)((pressure / 4095.0) * (cfg.screen_w - 20));
 		if (bar_w < 0) bar_w = 0;
@@ -428,13 +407,14 @@ int main(int argc, char** argv) {
 
 		// Raw-mapped pointer (gray) and output pointer (red)
 		// Gray uses the same swap/invert + min/max mapping as the calibrator (pre-advanced pipeline).
-		auto raw_pos = scale_raw_to_screen(raw_x, raw_y, cfg, invert_x, invert_y, swap_xy);
-		draw_pointer(ren, raw_pos.first, raw_pos.second, GRAY, BLACK);
+		int raw_sx = 0, raw_sy = 0;
+		raw_mapper.map(raw_x, raw_y, raw_sx, raw_sy);
+		draw_pointer(ren, raw_sx, raw_sy, GRAY, BLACK);
 		if (down) draw_pointer(ren, out_x, out_y, RED, BLACK);
 
 		// Minimal on-screen text
 		draw_text_5x7(ren, 10, 28, std::string("RAW:"), BLACK, 2);
-		draw_text_5x7(ren, 10 + 6 * 2 * 4, 28, std::to_string(raw_pos.first) + ":" + std::to_string(raw_pos.second), BLACK, 2);
+		draw_text_5x7(ren, 10 + 6 * 2 * 4, 28, std::to_string(raw_sx) + ":" + std::to_string(raw_sy), BLACK, 2);
 		draw_text_5x7(ren, 10, 44, std::string("OUT:"), BLACK, 2);
 		draw_text_5x7(ren, 10 + 6 * 2 * 4, 44, std::to_string(out_x) + ":" + std::to_string(out_y), BLACK, 2);
 		draw_text_5x7(ren, 10, 60, std::string("DOWN:"), BLACK, 2);
@@ -451,6 +431,15 @@ int main(int argc, char** argv) {
 			draw_text_5x7(ren, 10 + 6 * 2 * 2, 76, g, BLACK, 2);
 		}
 
+		if (show_mesh && cfg.mesh.size > 0) {
+			const float* d = &cfg.mesh.offsets[(size_t)mesh_sel * 2];
+			draw_text_5x7(ren, 10, 92, std::string("MESH:"), BLACK, 2);
+			draw_text_5x7(ren, 10 + 6 * 2 * 5, 92,
+						  std::to_string(mesh_sel % cfg.mesh.size) + ":" + std::to_string(mesh_sel / cfg.mesh.size) + " " +
+							  std::to_string((int)d[0]) + ":" + std::to_string((int)d[1]),
+						  BLACK, 2);
+		}
+
 		SDL_RenderPresent(ren);
 		SDL_Delay(16);
 	}
@@ -460,6 +449,8 @@ int main(int argc, char** argv) {
 		int st = 0;
 		waitpid(pid, &st, 0);
 	}
+	feed.close();
+	if (!live) unlink(feedPath.c_str());
 
 	SDL_DestroyRenderer(ren);
 	SDL_DestroyWindow(win);
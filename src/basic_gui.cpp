@@ -5,72 +5,14 @@
 #include <string>
 #include <vector>
 #include <fstream>
-#include <sstream>
-#include <regex>
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
-// ...existing code up to get_exe_dir()...
-static std::string get_exe_dir() {
-    char buf[4096];
-    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf)-1);
-    if (n <= 0) return std::string();
-    buf[n] = '\0';
-    std::string path(buf);
-    size_t pos = path.find_last_of('/');
-    if (pos == std::string::npos) return std::string();
-    return path.substr(0, pos);
-}
 
-static std::string find_config_path() {
-    // ...existing code...
-    const char* envPath = getenv("TOUCH_CONFIG_PATH");
-    if (envPath && *envPath) {
-        std::ifstream f(envPath);
-        if (f.good()) return std::string(envPath);
-    }
-    std::vector<std::string> candidates;
-    candidates.push_back("/etc/xpt2046/touch_config.txt");
-    candidates.push_back("installation/touch_config.txt");
-    candidates.push_back("touch_config.txt");
-    std::string exeDir = get_exe_dir();
-    if (!exeDir.empty()) {
-        candidates.push_back(exeDir + "/installation/touch_config.txt");
-        candidates.push_back(exeDir + "/../installation/touch_config.txt");
-    }
-    for (const auto& p : candidates) {
-        std::ifstream f(p);
-        if (f.good()) return p;
-    }
-    return std::string();
-}
-
-static void load_ranges(const std::string& cfgPath, int& min_x, int& max_x, int& min_y, int& max_y) {
-    // ...existing code...
-    min_x = 0; max_x = 4095; min_y = 0; max_y = 4095;
-    if (cfgPath.empty()) return;
-    std::ifstream in(cfgPath);
-    if (!in.good()) return;
-    std::string line;
-    while (std::getline(in, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        auto pos = line.find('=');
-        if (pos == std::string::npos) continue;
-        std::string key = line.substr(0, pos);
-        std::string val = line.substr(pos + 1);
-        auto ltrim = [](std::string& s){ s.erase(0, s.find_first_not_of(" \t")); };
-        auto rtrim = [](std::string& s){ s.erase(s.find_last_not_of(" \t") + 1); };
-        ltrim(key); rtrim(key); ltrim(val); rtrim(val);
-        int iv = std::atoi(val.c_str());
-        if (key == "min_x") min_x = iv;
-        else if (key == "max_x") max_x = iv;
-        else if (key == "min_y") min_y = iv;
-        else if (key == "max_y") max_y = iv;
-    }
-    if (max_x <= min_x) max_x = min_x + 1;
-    if (max_y <= min_y) max_y = min_y + 1;
-}
+#include "xpt2046_config.h"
+#include "xpt2046_feed.h"
 
 static std::string find_calibrator_binary() {
     // ...existing code...
@@ -291,20 +233,15 @@ int main(int argc, char** argv) {
         }
     };
 
-    // Load config ranges
     std::string cfg = find_config_path();
-    int min_x, max_x, min_y, max_y;
-    load_ranges(cfg, min_x, max_x, min_y, max_y);
-    // Allow environment overrides for live testing (from calibrate.sh)
-    if (const char* v = getenv("XPT_MIN_X")) { if (*v) min_x = std::atoi(v); }
-    if (const char* v = getenv("XPT_MAX_X")) { if (*v) max_x = std::atoi(v); }
-    if (const char* v = getenv("XPT_MIN_Y")) { if (*v) min_y = std::atoi(v); }
-    if (const char* v = getenv("XPT_MAX_Y")) { if (*v) max_y = std::atoi(v); }
-    // Use ranges directly; calibrator applies swap/invert before clamping
 
     // Start calibrator process
-    std::string calibrator = find_calibrator_binary();
-    if (calibrator.empty()) {
+    // XPT_GUI_FEED names the feed of a running daemon (calibrate.sh sets it
+    // when the daemon is live); no calibrator child reopens SPI then.
+    const char* liveFeed = getenv("XPT_GUI_FEED");
+    const bool live = liveFeed && *liveFeed;
+    std::string calibrator = live ? std::string() : find_calibrator_binary();
+    if (!live && calibrator.empty()) {
         std::fprintf(stderr, "[ERROR] xpt2046_calibrator binary not found. Build it first.\n");
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
@@ -312,21 +249,16 @@ int main(int argc, char** argv) {
         return 1;
     }
 
-    int pipefd[2];
-    if (pipe(pipefd) != 0) {
-        std::fprintf(stderr, "[ERROR] pipe() failed\n");
-        SDL_DestroyRenderer(ren);
-        SDL_DestroyWindow(win);
-        SDL_Quit();
-        return 1;
-    }
-    pid_t pid = fork();
+    // The calibrator publishes every frame into a shared-memory feed of our
+    // own (so a running daemon's feed is left alone); its text output is not
+    // needed.
+    const std::string feedPath = live ? std::string(liveFeed) : "/dev/shm/xpt2046-gui-" + std::to_string(getpid());
+    pid_t pid = live ? -1 : fork();
     if (pid == 0) {
-        // Child: exec calibrator, redirect stdout to pipe
-        close(pipefd[0]);
-        dup2(pipefd[1], STDOUT_FILENO);
-        dup2(pipefd[1], STDERR_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
         setenv("CALIBRATION_RUNNING", "1", 1);
+        setenv("XPT_FEED_SHM", feedPath.c_str(), 1);
         if (!cfg.empty()) setenv("TOUCH_CONFIG_PATH", cfg.c_str(), 1);
         // Pass optional invert/swap from environment (set by calibrate.sh)
         const char* ix = getenv("XPT_INVERT_X");
@@ -342,33 +274,13 @@ int main(int argc, char** argv) {
         std::perror("execv");
         _exit(127);
     }
-    // Parent
-    close(pipefd[1]);
-    FILE* pipeIn = fdopen(pipefd[0], "r");
-
-    // Non-blocking read lines from pipe
-    int pipe_fd = fileno(pipeIn);
-    int flags = fcntl(pipe_fd, F_GETFL, 0);
-    fcntl(pipe_fd, F_SETFL, flags | O_NONBLOCK);
-    char buf[1024];
-
-    // Regex to parse driver output lines
-    // Supports both formats:
-    //  - legacy: X/Y are raw-axis units
-    //  - new: includes SX/SY (screen coords)
-    std::regex re(R"(^\[SPI\]\s+XPT2046\s+X:\s*(\d+)\s+Y:\s*(\d+)\s+\(raw X:\s*(\d+)\s+raw Y:\s*(\d+)(?:\s+SX:\s*(\d+)\s+SY:\s*(\d+))?(?:\s+Z:\s*(\d+))?(?:\s+DOWN:\s*(\d+))?.*\))");
+    FeedReader feed;
+    FeedFrame frames[64];
 
     UIState st;
     IdleCursorMode idleMode = parse_idle_cursor_mode(getenv("XPT_GUI_IDLE_CURSOR"));
     std::fprintf(stderr, "[INFO] GUI idle cursor mode: %s (press 'i' to cycle)\n", idle_cursor_mode_name(idleMode));
     bool running = true;
-    auto scale_to_screen = [&](int x, int y){
-        int sx = (int)((x - min_x) * (width / (double)(max_x - min_x)));
-        int sy = (int)((y - min_y) * (height / (double)(max_y - min_y)));
-        if (sx < 0) sx = 0; if (sy < 0) sy = 0;
-        if (sx >= width) sx = width-1; if (sy >= height) sy = height-1;
-        return std::pair<int,int>(sx, sy);
-    };
 
     while (running) {
         int pressedEdgeBtn = -1;
@@ -388,66 +300,42 @@ int main(int argc, char** argv) {
                 }
             }
         }
-        // Read latest driver line(s)
-        ssize_t n = read(pipe_fd, buf, sizeof(buf)-1);
-        if (n > 0) {
-            buf[n] = '\0';
-            std::istringstream iss{std::string(buf)};
-            std::string line;
-            while (std::getline(iss, line)) {
-                std::smatch m;
-                if (std::regex_search(line, m, re)) {
-                    int x = std::atoi(m[1].str().c_str());
-                    int y = std::atoi(m[2].str().c_str());
-                    int rx = std::atoi(m[3].str().c_str());
-                    int ry = std::atoi(m[4].str().c_str());
-                    int sx = (m.size() > 5 && m[5].matched) ? std::atoi(m[5].str().c_str()) : -1;
-                    int sy = (m.size() > 6 && m[6].matched) ? std::atoi(m[6].str().c_str()) : -1;
-                    int z = (m.size() > 7 && m[7].matched) ? std::atoi(m[7].str().c_str()) : -1;
-                    int down = (m.size() > 8 && m[8].matched) ? std::atoi(m[8].str().c_str()) : -1;
-                    st.raw_x = rx; st.raw_y = ry;
-
-                    // Touch presence: prefer DOWN if present, else Z, else old heuristic
-                    bool touch = false;
-                    if (down == 0 || down == 1) touch = (down == 1);
-                    else if (z >= 0) touch = (z > 0);
-                    else touch = (rx >= 50 && rx <= 4045 && ry >= 50 && ry <= 4045);
-                    st.touch_present = touch;
-
-                    // Prefer SX/SY if present; otherwise scale X/Y using min/max
-                    if (st.touch_present || idleMode == IdleCursorMode::ShowRaw) {
-                        if (sx >= 0 && sy >= 0) {
-                            if (sx < 0) sx = 0; if (sy < 0) sy = 0;
-                            if (sx >= width) sx = width - 1;
-                            if (sy >= height) sy = height - 1;
-                            st.cx = sx; st.cy = sy;
-                        } else {
-                            auto p = scale_to_screen(x, y);
-                            st.cx = p.first; st.cy = p.second;
-                        }
-                    }
-                    if (st.touch_present) {
-                        st.last_touch_x = st.cx;
-                        st.last_touch_y = st.cy;
-                    }
+        // Every frame published since the last render, so a short touch
+        // between two renders still reaches the buttons.
+        if (!feed.is_open()) feed.open(feedPath); // once the calibrator created it
+        const size_t n = feed.read_new(frames, sizeof(frames) / sizeof(frames[0]));
+        for (size_t i = 0; i < n; ++i) {
+            const FeedFrame& f = frames[i];
+            st.raw_x = f.raw_x; st.raw_y = f.raw_y;
+            st.touch_present = f.down != 0;
+
+            if (st.touch_present || idleMode == IdleCursorMode::ShowRaw) {
+                int sx = f.out_x, sy = f.out_y;
+                if (sx < 0) sx = 0; if (sy < 0) sy = 0;
+                if (sx >= width) sx = width - 1;
+                if (sy >= height) sy = height - 1;
+                st.cx = sx; st.cy = sy;
+            }
+            if (st.touch_present) {
+                st.last_touch_x = st.cx;
+                st.last_touch_y = st.cy;
+            }
 
-                    // UI interactions should only happen when touching.
-                    if (st.touch_present) {
-                        SDL_Point pt{st.cx, st.cy};
-                        if (SDL_PointInRect(&pt, &btnExt)) running = false;
-                        st.toggled = SDL_PointInRect(&pt, &btn2);
-                        if (SDL_PointInRect(&pt, &slider)) {
-                            st.dragging_slider = true;
-                            int rel = st.cx - slider.x; if (rel < 0) rel = 0; if (rel > slider.w) rel = slider.w;
-                            st.slider_value = rel / (float)slider.w;
-                        } else {
-                            st.dragging_slider = false;
-                        }
-                    } else {
-                        st.toggled = false;
-                        st.dragging_slider = false;
-                    }
+            // UI interactions should only happen when touching.
+            if (st.touch_present) {
+                SDL_Point pt{st.cx, st.cy};
+                if (SDL_PointInRect(&pt, &btnExt)) running = false;
+                st.toggled = SDL_PointInRect(&pt, &btn2);
+                if (SDL_PointInRect(&pt, &slider)) {
+                    st.dragging_slider = true;
+                    int rel = st.cx - slider.x; if (rel < 0) rel = 0; if (rel > slider.w) rel = slider.w;
+                    st.slider_value = rel / (float)slider.w;
+                } else {
+                    st.dragging_slider = false;
                 }
+            } else {
+                st.toggled = false;
+                st.dragging_slider = false;
             }
         }
 
@@ -497,8 +385,13 @@ int main(int argc, char** argv) {
     }
 
     // Cleanup
-    fclose(pipeIn);
-    int status = 0; if (pid > 0) waitpid(pid, &status, 0);
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        int status = 0;
+        waitpid(pid, &status, 0);
+    }
+    feed.close();
+    if (!live) unlink(feedPath.c_str());
     SDL_DestroyRenderer(ren);
     SDL_DestroyWindow(win);
     SDL_Quit();
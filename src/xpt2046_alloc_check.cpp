@@ -0,0 +1,84 @@
+#include "xpt2046_alloc_check.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<uint64_t> g_allocs{0};
+std::atomic<uint64_t> g_violations{0};
+std::atomic<bool> g_enabled{false};
+std::atomic<bool> g_armed{false};
+thread_local int t_scope_depth = 0;
+
+void* counted_alloc(size_t size) {
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	if (t_scope_depth > 0 && g_armed.load(std::memory_order_relaxed)) {
+		g_violations.fetch_add(1, std::memory_order_relaxed);
+		if (g_enabled.load(std::memory_order_relaxed)) {
+			// No iostreams here: they could allocate and recurse.
+			static const char msg[] = "[ERROR] XPT_ALLOC_CHECK: heap allocation in the per-sample path after warm-up\n";
+			(void)write(STDERR_FILENO, msg, sizeof(msg) - 1);
+			std::abort();
+		}
+	}
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+	return counted_alloc(size);
+}
+
+void* operator new[](size_t size) {
+	return counted_alloc(size);
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	std::free(p);
+}
+
+uint64_t alloc_count() {
+	return g_allocs.load(std::memory_order_relaxed);
+}
+
+uint64_t alloc_violations() {
+	return g_violations.load(std::memory_order_relaxed);
+}
+
+bool alloc_check_init() {
+	const char* v = getenv("XPT_ALLOC_CHECK");
+	const bool on = v && *v && std::strcmp(v, "0") != 0;
+	g_enabled.store(on, std::memory_order_relaxed);
+	return on;
+}
+
+void alloc_check_arm() {
+	g_armed.store(true, std::memory_order_relaxed);
+}
+
+AllocFreeScope::AllocFreeScope() {
+	++t_scope_depth;
+}
+
+AllocFreeScope::~AllocFreeScope() {
+	--t_scope_depth;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocation counter for the per-sample path. Linking
+// xpt2046_alloc_check.cpp replaces the global operator new/delete with
+// counting versions. Code that must stay allocation-free runs inside an
+// AllocFreeScope; once the check is enabled (XPT_ALLOC_CHECK=1) and armed
+// after warm-up, any allocation inside such a scope aborts the process with
+// a message on stderr.
+
+// Total allocations through operator new since start (all threads).
+uint64_t alloc_count();
+
+// Allocations seen inside AllocFreeScope after arming (only reached when the
+// check is not enabled, since enabled checks abort instead).
+uint64_t alloc_violations();
+
+// Reads XPT_ALLOC_CHECK. Returns true if the check is enabled.
+bool alloc_check_init();
+
+// Start enforcing; call once warm-up is over.
+void alloc_check_arm();
+
+class AllocFreeScope {
+public:
+	AllocFreeScope();
+	~AllocFreeScope();
+	AllocFreeScope(const AllocFreeScope&) = delete;
+	AllocFreeScope& operator=(const AllocFreeScope&) = delete;
+};
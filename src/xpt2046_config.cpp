@@ -0,0 +1,480 @@
+#include "xpt2046_config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+std::string get_exe_dir() {
+	char buf[4096];
+	ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+	if (n <= 0) return std::string();
+	buf[n] = '\0';
+	std::string path(buf);
+	size_t pos = path.find_last_of('/');
+	if (pos == std::string::npos) return std::string();
+	return path.substr(0, pos);
+}
+
+std::vector<std::string> config_search_paths() {
+	std::vector<std::string> candidates;
+	const char* envPath = getenv("TOUCH_CONFIG_PATH");
+	if (envPath && *envPath) candidates.push_back(envPath);
+
+	// System-wide config (useful when running as a system service)
+	candidates.push_back("/etc/xpt2046/touch_config.txt");
+	// Relative to current working directory
+	candidates.push_back("touch_config.txt");
+	candidates.push_back("installation/touch_config.txt");
+
+	// Relative to executable directory (binary usually in build/, config in ../installation/)
+	std::string exeDir = get_exe_dir();
+	if (!exeDir.empty()) {
+		candidates.push_back(exeDir + "/touch_config.txt");
+		candidates.push_back(exeDir + "/installation/touch_config.txt");
+		candidates.push_back(exeDir + "/../installation/touch_config.txt");
+	}
+	return candidates;
+}
+
+std::string find_config_path() {
+	for (const auto& p : config_search_paths()) {
+		std::ifstream f(p);
+		if (f.good()) return p;
+	}
+	return std::string();
+}
+
+bool parse_int(const std::string& s, int& out) {
+	char* end = nullptr;
+	long v = std::strtol(s.c_str(), &end, 10);
+	if (end == s.c_str()) return false;
+	out = (int)v;
+	return true;
+}
+
+bool parse_float(const std::string& s, float& out) {
+	char* end = nullptr;
+	float v = std::strtof(s.c_str(), &end);
+	if (end == s.c_str()) return false;
+	out = v;
+	return true;
+}
+
+namespace {
+
+// Every key touch_config.txt may hold, in the order "get" lists them. Exactly
+// one member pointer is set per entry.
+struct KeyDef {
+	const char* key;
+	int ConfigValues::*top_int;
+	std::string ConfigValues::*top_str;
+	int AdvancedParams::*adv_int;
+	float AdvancedParams::*adv_float;
+	std::string AdvancedParams::*adv_str;
+};
+
+const KeyDef kKeys[] = {
+	{"invert_x", &ConfigValues::invert_x, nullptr, nullptr, nullptr, nullptr},
+	{"invert_y", &ConfigValues::invert_y, nullptr, nullptr, nullptr, nullptr},
+	{"swap_xy", &ConfigValues::swap_xy, nullptr, nullptr, nullptr, nullptr},
+	{"min_x", &ConfigValues::min_x, nullptr, nullptr, nullptr, nullptr},
+	{"max_x", &ConfigValues::max_x, nullptr, nullptr, nullptr, nullptr},
+	{"min_y", &ConfigValues::min_y, nullptr, nullptr, nullptr, nullptr},
+	{"max_y", &ConfigValues::max_y, nullptr, nullptr, nullptr, nullptr},
+	{"spi_device", nullptr, &ConfigValues::spi_device, nullptr, nullptr, nullptr},
+	{"screen_w", nullptr, nullptr, &AdvancedParams::screen_w, nullptr, nullptr},
+	{"screen_h", nullptr, nullptr, &AdvancedParams::screen_h, nullptr, nullptr},
+	{"poll_us", nullptr, nullptr, &AdvancedParams::poll_us, nullptr, nullptr},
+	{"rt_priority", nullptr, nullptr, &AdvancedParams::rt_priority, nullptr, nullptr},
+	{"deadline_miss_us", nullptr, nullptr, &AdvancedParams::deadline_miss_us, nullptr, nullptr},
+	{"offset_x", nullptr, nullptr, &AdvancedParams::offset_x, nullptr, nullptr},
+	{"offset_y", nullptr, nullptr, &AdvancedParams::offset_y, nullptr, nullptr},
+	{"scale_x", nullptr, nullptr, nullptr, &AdvancedParams::scale_x, nullptr},
+	{"scale_y", nullptr, nullptr, nullptr, &AdvancedParams::scale_y, nullptr},
+	{"deadzone_left", nullptr, nullptr, &AdvancedParams::deadzone_left, nullptr, nullptr},
+	{"deadzone_right", nullptr, nullptr, &AdvancedParams::deadzone_right, nullptr, nullptr},
+	{"deadzone_top", nullptr, nullptr, &AdvancedParams::deadzone_top, nullptr, nullptr},
+	{"deadzone_bottom", nullptr, nullptr, &AdvancedParams::deadzone_bottom, nullptr, nullptr},
+	{"affine", nullptr, nullptr, nullptr, nullptr, &AdvancedParams::affine},
+	{"mesh", nullptr, nullptr, nullptr, nullptr, &AdvancedParams::mesh},
+	{"median_window", nullptr, nullptr, &AdvancedParams::median_window, nullptr, nullptr},
+	{"burst_xy", nullptr, nullptr, &AdvancedParams::burst_xy, nullptr, nullptr},
+	{"burst_z", nullptr, nullptr, &AdvancedParams::burst_z, nullptr, nullptr},
+	{"burst_reduce", nullptr, nullptr, &AdvancedParams::burst_reduce, nullptr, nullptr},
+	{"iir_alpha", nullptr, nullptr, nullptr, &AdvancedParams::iir_alpha, nullptr},
+	{"euro_min_cutoff", nullptr, nullptr, nullptr, &AdvancedParams::euro_min_cutoff, nullptr},
+	{"euro_beta", nullptr, nullptr, nullptr, &AdvancedParams::euro_beta, nullptr},
+	{"euro_d_cutoff", nullptr, nullptr, nullptr, &AdvancedParams::euro_d_cutoff, nullptr},
+	{"kalman_noise_px", nullptr, nullptr, nullptr, &AdvancedParams::kalman_noise_px, nullptr},
+	{"kalman_accel", nullptr, nullptr, nullptr, &AdvancedParams::kalman_accel, nullptr},
+	{"predict_ms", nullptr, nullptr, &AdvancedParams::predict_ms, nullptr, nullptr},
+	{"predict_max_px", nullptr, nullptr, &AdvancedParams::predict_max_px, nullptr, nullptr},
+	{"press_threshold", nullptr, nullptr, &AdvancedParams::press_threshold, nullptr, nullptr},
+	{"release_threshold", nullptr, nullptr, &AdvancedParams::release_threshold, nullptr, nullptr},
+	{"confirm_samples", nullptr, nullptr, &AdvancedParams::confirm_samples, nullptr, nullptr},
+	{"confirm_votes", nullptr, nullptr, &AdvancedParams::confirm_votes, nullptr, nullptr},
+	{"confirm_gap_us", nullptr, nullptr, &AdvancedParams::confirm_gap_us, nullptr, nullptr},
+	{"release_max_ms", nullptr, nullptr, &AdvancedParams::release_max_ms, nullptr, nullptr},
+	{"release_timeout_ms", nullptr, nullptr, &AdvancedParams::release_timeout_ms, nullptr, nullptr},
+	{"max_delta_px", nullptr, nullptr, &AdvancedParams::max_delta_px, nullptr, nullptr},
+	{"penirq_chip", nullptr, nullptr, nullptr, nullptr, &AdvancedParams::penirq_chip},
+	{"penirq_line", nullptr, nullptr, &AdvancedParams::penirq_line, nullptr, nullptr},
+	{"acq_cpu", nullptr, nullptr, &AdvancedParams::acq_cpu, nullptr, nullptr},
+	{"abs_fuzz", nullptr, nullptr, &AdvancedParams::abs_fuzz, nullptr, nullptr},
+	{"panel_width_mm", nullptr, nullptr, &AdvancedParams::panel_width_mm, nullptr, nullptr},
+	{"panel_height_mm", nullptr, nullptr, &AdvancedParams::panel_height_mm, nullptr, nullptr},
+	{"ctl_socket", nullptr, nullptr, nullptr, nullptr, &AdvancedParams::ctl_socket},
+	{"feed_shm", nullptr, nullptr, nullptr, nullptr, &AdvancedParams::feed_shm},
+	{"tap_max_ms", nullptr, nullptr, &AdvancedParams::tap_max_ms, nullptr, nullptr},
+	{"tap_max_move_px", nullptr, nullptr, &AdvancedParams::tap_max_move_px, nullptr, nullptr},
+	{"drag_start_px", nullptr, nullptr, &AdvancedParams::drag_start_px, nullptr, nullptr},
+};
+
+const KeyDef* find_key(const std::string& key) {
+	for (const auto& k : kKeys) {
+		if (key == k.key) return &k;
+	}
+	return nullptr;
+}
+
+} // namespace
+
+bool set_config_value(ConfigValues& v, const std::string& key, const std::string& val) {
+	const KeyDef* k = find_key(key);
+	if (!k) return false;
+	int iv = 0;
+	float fv = 0.0f;
+	if (k->top_int) {
+		if (!parse_int(val, iv)) return false;
+		v.*(k->top_int) = iv;
+	} else if (k->top_str) {
+		v.*(k->top_str) = val;
+	} else if (k->adv_int) {
+		if (!parse_int(val, iv)) return false;
+		v.adv.*(k->adv_int) = iv;
+	} else if (k->adv_float) {
+		if (!parse_float(val, fv)) return false;
+		v.adv.*(k->adv_float) = fv;
+	} else {
+		v.adv.*(k->adv_str) = val;
+	}
+	return true;
+}
+
+bool get_config_value(const ConfigValues& v, const std::string& key, std::string& out) {
+	const KeyDef* k = find_key(key);
+	if (!k) return false;
+	if (k->top_int) out = std::to_string(v.*(k->top_int));
+	else if (k->top_str) out = v.*(k->top_str);
+	else if (k->adv_int) out = std::to_string(v.adv.*(k->adv_int));
+	else if (k->adv_float) {
+		std::ostringstream os;
+		os << v.adv.*(k->adv_float);
+		out = os.str();
+	} else out = v.adv.*(k->adv_str);
+	return true;
+}
+
+std::vector<std::string> config_keys() {
+	std::vector<std::string> keys;
+	for (const auto& k : kKeys) keys.push_back(k.key);
+	return keys;
+}
+
+void load_config(int& invert_x, int& invert_y, int& swap_xy,
+				 int& min_x, int& max_x, int& min_y, int& max_y,
+				 AdvancedParams& adv,
+				 std::string& usedPath,
+				 std::string& spi_device_cfg) {
+	invert_x = invert_y = swap_xy = 0;
+	min_x = min_y = 0;
+	max_x = max_y = 4095;
+
+	usedPath = find_config_path();
+	if (usedPath.empty()) return;
+
+	std::ifstream in(usedPath);
+	if (!in.good()) {
+		usedPath.clear();
+		return;
+	}
+	ConfigValues v;
+	v.adv = adv;
+	v.spi_device = spi_device_cfg;
+	std::string line;
+	while (std::getline(in, line)) {
+		// Skip comments and malformed lines
+		if (line.empty() || line[0] == '#') continue;
+		auto pos = line.find('=');
+		if (pos == std::string::npos) continue;
+		std::string key = line.substr(0, pos);
+		std::string val = line.substr(pos + 1);
+		auto ltrim = [](std::string& s) { s.erase(0, s.find_first_not_of(" \t")); };
+		auto rtrim = [](std::string& s) { s.erase(s.find_last_not_of(" \t") + 1); };
+		ltrim(key);
+		rtrim(key);
+		ltrim(val);
+		rtrim(val);
+		(void)set_config_value(v, key, val);
+	}
+	invert_x = v.invert_x;
+	invert_y = v.invert_y;
+	swap_xy = v.swap_xy;
+	min_x = v.min_x;
+	max_x = v.max_x;
+	min_y = v.min_y;
+	max_y = v.max_y;
+	adv = v.adv;
+	spi_device_cfg = v.spi_device;
+}
+
+void apply_env_overrides(int& invert_x, int& invert_y, int& swap_xy,
+						 int& min_x, int& max_x, int& min_y, int& max_y,
+						 AdvancedParams& adv,
+						 std::string& spi_device_cfg) {
+	auto env_i = [](const char* name, int& dst) {
+		const char* v = getenv(name);
+		if (v && *v) dst = std::atoi(v);
+	};
+	auto env_f = [](const char* name, float& dst) {
+		const char* v = getenv(name);
+		if (v && *v) dst = std::strtof(v, nullptr);
+	};
+	auto env_s = [](const char* name, std::string& dst) {
+		const char* v = getenv(name);
+		if (v && *v) dst = v;
+	};
+
+	env_s("XPT_SPI_DEVICE", spi_device_cfg);
+
+	env_i("XPT_INVERT_X", invert_x);
+	env_i("XPT_INVERT_Y", invert_y);
+	env_i("XPT_SWAP_XY", swap_xy);
+	env_i("XPT_MIN_X", min_x);
+	env_i("XPT_MAX_X", max_x);
+	env_i("XPT_MIN_Y", min_y);
+	env_i("XPT_MAX_Y", max_y);
+
+	env_i("XPT_SCREEN_W", adv.screen_w);
+	env_i("XPT_SCREEN_H", adv.screen_h);
+	env_i("XPT_POLL_US", adv.poll_us);
+	env_i("XPT_RT_PRIORITY", adv.rt_priority);
+	env_i("XPT_DEADLINE_MISS_US", adv.deadline_miss_us);
+	env_i("XPT_OFFSET_X", adv.offset_x);
+	env_i("XPT_OFFSET_Y", adv.offset_y);
+	env_f("XPT_SCALE_X", adv.scale_x);
+	env_f("XPT_SCALE_Y", adv.scale_y);
+	env_i("XPT_DEADZONE_LEFT", adv.deadzone_left);
+	env_i("XPT_DEADZONE_RIGHT", adv.deadzone_right);
+	env_i("XPT_DEADZONE_TOP", adv.deadzone_top);
+	env_i("XPT_DEADZONE_BOTTOM", adv.deadzone_bottom);
+	env_s("XPT_AFFINE", adv.affine);
+	env_s("XPT_MESH", adv.mesh);
+	env_i("XPT_MEDIAN_WINDOW", adv.median_window);
+	env_i("XPT_BURST_XY", adv.burst_xy);
+	env_i("XPT_BURST_Z", adv.burst_z);
+	env_i("XPT_BURST_REDUCE", adv.burst_reduce);
+	env_f("XPT_IIR_ALPHA", adv.iir_alpha);
+	env_f("XPT_EURO_MIN_CUTOFF", adv.euro_min_cutoff);
+	env_f("XPT_EURO_BETA", adv.euro_beta);
+	env_f("XPT_EURO_D_CUTOFF", adv.euro_d_cutoff);
+	env_f("XPT_KALMAN_NOISE_PX", adv.kalman_noise_px);
+	env_f("XPT_KALMAN_ACCEL", adv.kalman_accel);
+	env_i("XPT_PREDICT_MS", adv.predict_ms);
+	env_i("XPT_PREDICT_MAX_PX", adv.predict_max_px);
+	env_i("XPT_PRESS_THRESHOLD", adv.press_threshold);
+	env_i("XPT_RELEASE_THRESHOLD", adv.release_threshold);
+	env_i("XPT_CONFIRM_SAMPLES", adv.confirm_samples);
+	env_i("XPT_CONFIRM_VOTES", adv.confirm_votes);
+	env_i("XPT_CONFIRM_GAP_US", adv.confirm_gap_us);
+	env_i("XPT_RELEASE_MAX_MS", adv.release_max_ms);
+	env_i("XPT_RELEASE_TIMEOUT_MS", adv.release_timeout_ms);
+	env_i("XPT_MAX_DELTA_PX", adv.max_delta_px);
+	env_s("XPT_PENIRQ_CHIP", adv.penirq_chip);
+	env_i("XPT_PENIRQ_LINE", adv.penirq_line);
+	env_i("XPT_ACQ_CPU", adv.acq_cpu);
+	env_i("XPT_ABS_FUZZ", adv.abs_fuzz);
+	env_i("XPT_PANEL_WIDTH_MM", adv.panel_width_mm);
+	env_i("XPT_PANEL_HEIGHT_MM", adv.panel_height_mm);
+	env_s("XPT_CTL_SOCKET", adv.ctl_socket);
+	env_s("XPT_FEED_SHM", adv.feed_shm);
+	env_i("XPT_TAP_MAX_MS", adv.tap_max_ms);
+	env_i("XPT_TAP_MAX_MOVE_PX", adv.tap_max_move_px);
+	env_i("XPT_DRAG_START_PX", adv.drag_start_px);
+}
+
+void sanitize_adv(AdvancedParams& adv) {
+	adv.screen_w = clamp_val(adv.screen_w, 1, 4096);
+	adv.screen_h = clamp_val(adv.screen_h, 1, 4096);
+	adv.poll_us = clamp_val(adv.poll_us, 1000, 1000000);
+	adv.rt_priority = clamp_val(adv.rt_priority, 0, 99);
+	adv.deadline_miss_us = clamp_val(adv.deadline_miss_us, 0, 1000000);
+	adv.scale_x = clamp_val(adv.scale_x, 0.01f, 10.0f);
+	adv.scale_y = clamp_val(adv.scale_y, 0.01f, 10.0f);
+	adv.iir_alpha = clamp_val(adv.iir_alpha, 0.0f, 1.0f);
+	adv.euro_min_cutoff = clamp_val(adv.euro_min_cutoff, 0.0f, 100.0f);
+	adv.euro_beta = clamp_val(adv.euro_beta, 0.0f, 10.0f);
+	adv.euro_d_cutoff = clamp_val(adv.euro_d_cutoff, 0.01f, 100.0f);
+	adv.kalman_noise_px = clamp_val(adv.kalman_noise_px, 0.0f, 100.0f);
+	adv.kalman_accel = clamp_val(adv.kalman_accel, 1.0f, 1000000.0f);
+	adv.predict_ms = clamp_val(adv.predict_ms, 0, 50);
+	adv.predict_max_px = clamp_val(adv.predict_max_px, 0, 200);
+	if (!(adv.median_window == 0 || adv.median_window == 3 || adv.median_window == 5 || adv.median_window == 7 ||
+		  adv.median_window == 9)) {
+		adv.median_window = 3;
+	}
+	adv.burst_xy = clamp_val(adv.burst_xy, 1, 16);
+	adv.burst_z = clamp_val(adv.burst_z, 1, 16);
+	adv.burst_reduce = clamp_val(adv.burst_reduce, 0, 1);
+	if (adv.release_threshold > adv.press_threshold) adv.release_threshold = adv.press_threshold;
+	adv.confirm_samples = clamp_val(adv.confirm_samples, 0, 16);
+	adv.confirm_votes = clamp_val(adv.confirm_votes, 1, std::max(1, adv.confirm_samples));
+	adv.confirm_gap_us = clamp_val(adv.confirm_gap_us, 0, 5000);
+	adv.release_max_ms = clamp_val(adv.release_max_ms, 1, 1000);
+	adv.release_timeout_ms = clamp_val(adv.release_timeout_ms, adv.release_max_ms, 5000);
+	adv.acq_cpu = clamp_val(adv.acq_cpu, -1, CPU_SETSIZE - 1);
+	adv.abs_fuzz = clamp_val(adv.abs_fuzz, -1, 64);
+	adv.panel_width_mm = clamp_val(adv.panel_width_mm, 0, 2000);
+	adv.panel_height_mm = clamp_val(adv.panel_height_mm, 0, 2000);
+}
+
+MappingParams mapping_params(int invert_x, int invert_y, int swap_xy,
+							 int min_x, int max_x, int min_y, int max_y,
+							 const AdvancedParams& adv) {
+	MappingParams m;
+	m.invert_x = invert_x;
+	m.invert_y = invert_y;
+	m.swap_xy = swap_xy;
+	m.min_x = min_x;
+	m.max_x = max_x;
+	m.min_y = min_y;
+	m.max_y = max_y;
+	m.screen_w = adv.screen_w;
+	m.screen_h = adv.screen_h;
+	m.offset_x = adv.offset_x;
+	m.offset_y = adv.offset_y;
+	m.scale_x = adv.scale_x;
+	m.scale_y = adv.scale_y;
+	m.deadzone_left = adv.deadzone_left;
+	m.deadzone_right = adv.deadzone_right;
+	m.deadzone_top = adv.deadzone_top;
+	m.deadzone_bottom = adv.deadzone_bottom;
+	if (!adv.affine.empty()) {
+		m.has_affine = parse_affine(adv.affine, m.affine);
+		if (!m.has_affine) {
+			std::cerr << "[WARN] Ignoring malformed affine=" << adv.affine << " (expected six numbers)." << std::endl;
+		}
+	}
+	if (!adv.mesh.empty() && !parse_mesh(adv.mesh, m.mesh)) {
+		std::cerr << "[WARN] Ignoring malformed mesh (expected N:dx,dy,... with N*N pairs, N=2.." << kMaxMeshSize << ")." << std::endl;
+	}
+	return m;
+}
+
+FilterParams filter_params(const AdvancedParams& adv) {
+	FilterParams f;
+	f.screen_w = adv.screen_w;
+	f.screen_h = adv.screen_h;
+	f.deadzone_left = adv.deadzone_left;
+	f.deadzone_right = adv.deadzone_right;
+	f.deadzone_top = adv.deadzone_top;
+	f.deadzone_bottom = adv.deadzone_bottom;
+	f.max_delta_px = adv.max_delta_px;
+	f.median_window = adv.median_window;
+	f.iir_alpha = adv.iir_alpha;
+	f.euro_min_cutoff = adv.euro_min_cutoff;
+	f.euro_beta = adv.euro_beta;
+	f.euro_d_cutoff = adv.euro_d_cutoff;
+	f.kalman_noise_px = adv.kalman_noise_px;
+	f.kalman_accel = adv.kalman_accel;
+	f.predict_ms = adv.predict_ms;
+	f.predict_max_px = adv.predict_max_px;
+	return f;
+}
+
+bool update_config_key(const std::string& cfgPath, const std::string& key, const std::string& value) {
+	if (value.empty()) return false;
+	return update_config_keys(cfgPath, {{key, value}});
+}
+
+bool update_config_keys(const std::string& cfgPath, const std::vector<std::pair<std::string, std::string>>& kv) {
+	if (cfgPath.empty() || kv.empty()) return false;
+	std::vector<std::string> lines;
+	std::vector<bool> replaced(kv.size(), false);
+	{
+		std::ifstream in(cfgPath);
+		std::string line;
+		while (std::getline(in, line)) {
+			for (size_t i = 0; i < kv.size(); ++i) {
+				if (line.rfind(kv[i].first + "=", 0) != 0) continue;
+				line = kv[i].first + "=" + kv[i].second;
+				replaced[i] = true;
+				break;
+			}
+			lines.push_back(line);
+		}
+	}
+	for (size_t i = 0; i < kv.size(); ++i) {
+		if (!replaced[i]) lines.push_back(kv[i].first + "=" + kv[i].second);
+	}
+	// Write a sibling and rename it over the config, so a reader (the daemon
+	// reloads on change) never sees a half-written file. A symlinked config is
+	// updated at its target, and the new file keeps the old one's mode and
+	// owner. Both fsyncs are needed for the rename to survive a power cut.
+	std::string realPath = cfgPath;
+	if (char* rp = realpath(cfgPath.c_str(), nullptr)) {
+		realPath = rp;
+		free(rp);
+	}
+	struct stat st;
+	const bool existed = stat(realPath.c_str(), &st) == 0;
+	const std::string tmpPath = realPath + ".tmp";
+	unlink(tmpPath.c_str());
+	const int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+		existed ? (st.st_mode & 07777) : 0644);
+	if (fd < 0) return false;
+	std::string data;
+	for (const auto& l : lines) data += l + "\n";
+	bool ok = true;
+	for (size_t off = 0; ok && off < data.size();) {
+		const ssize_t n = write(fd, data.data() + off, data.size() - off);
+		if (n < 0 && errno == EINTR) continue;
+		ok = n > 0;
+		if (ok) off += (size_t)n;
+	}
+	if (ok && existed) {
+		// Only root can give the file away; anyone else keeps their own uid.
+		if (fchown(fd, st.st_uid, st.st_gid) != 0 && errno != EPERM) ok = false;
+		if (ok && fchmod(fd, st.st_mode & 07777) != 0) ok = false;
+	}
+	if (ok && fsync(fd) != 0) ok = false;
+	if (close(fd) != 0) ok = false;
+	if (!ok || std::rename(tmpPath.c_str(), realPath.c_str()) != 0) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	const size_t slash = realPath.find_last_of('/');
+	const std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : realPath.substr(0, slash));
+	const int dfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd >= 0) {
+		fsync(dfd);
+		close(dfd);
+	}
+	return true;
+}
+
+std::string default_config_save_path(const std::string& existingCfg) {
+	if (!existingCfg.empty()) return existingCfg;
+	std::string exeDir = get_exe_dir();
+	if (!exeDir.empty()) return exeDir + "/../installation/touch_config.txt";
+	return std::string("installation/touch_config.txt");
+}
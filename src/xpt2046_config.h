@@ -0,0 +1,165 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xpt2046_mapping.h"
+#include "xpt2046_pipeline.h"
+
+// touch_config.txt handling shared by the daemon, the calibrator and the GUIs.
+// Format: one key=value per line, '#' starts a comment. XPT_* environment
+// variables override the file for live testing without saving.
+
+std::string get_exe_dir();
+
+// TOUCH_CONFIG_PATH, then /etc/xpt2046, the working directory and the
+// directories around the executable, in order of preference.
+std::vector<std::string> config_search_paths();
+
+// First readable entry of config_search_paths(); empty if none is.
+std::string find_config_path();
+
+bool parse_int(const std::string& s, int& out);
+bool parse_float(const std::string& s, float& out);
+
+template <typename T>
+inline T clamp_val(T v, T lo, T hi) {
+	return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+struct AdvancedParams {
+	int screen_w = 800;
+	int screen_h = 480;
+	int poll_us = 100000; // output/update interval; lower = faster, higher = less CPU/log spam
+
+	// Real-time profile: 0 = off, 1..99 = SCHED_FIFO priority of the acquisition
+	// thread (processing runs one below), plus mlockall, prefaulting and a
+	// pinned malloc arena. Needs CAP_SYS_NICE / CAP_IPC_LOCK (or root).
+	int rt_priority = 0;
+	// Count wakeups later than this as missed deadlines (0 = off).
+	int deadline_miss_us = 0;
+
+	int offset_x = 0;
+	int offset_y = 0;
+	float scale_x = 1.0f;
+	float scale_y = 1.0f;
+
+	int deadzone_left = 0;
+	int deadzone_right = 0;
+	int deadzone_top = 0;
+	int deadzone_bottom = 0;
+
+	// Affine calibration "a,b,c,d,e,f" (raw -> screen). Empty = use
+	// min/max + scale/offset.
+	std::string affine;
+	// Non-linear correction mesh "N:dx,dy,..." applied after the mapping above.
+	std::string mesh;
+
+	int median_window = 3; // 0,3,5,7,9
+	int burst_xy = 1; // X/Y conversions per axis per sample (1..16)
+	int burst_z = 1; // Z1/Z2 conversions per sample (1..16)
+	int burst_reduce = 0; // 0 = median of burst, 1 = trimmed mean
+	float iir_alpha = 0.20f; // 0..1 (0 disables)
+	// One Euro filter (speed-adaptive low-pass). euro_min_cutoff > 0 enables
+	// it in place of the IIR stage; cutoffs in Hz, beta per px/s of speed.
+	float euro_min_cutoff = 0.0f;
+	float euro_beta = 0.01f;
+	float euro_d_cutoff = 1.0f;
+	// Kalman tracker after the smoothing stage. kalman_noise_px > 0 enables
+	// it; predict_ms extrapolates the emitted position by that much, at most
+	// predict_max_px, and only while the pressure is above press_threshold.
+	float kalman_noise_px = 0.0f;
+	float kalman_accel = 30000.0f;
+	int predict_ms = 0;
+	int predict_max_px = 24;
+
+	int press_threshold = 120;
+	int release_threshold = 80;
+	// Touch-down confirmation: when an idle sample crosses press_threshold the
+	// daemon takes confirm_samples more reads confirm_gap_us apart and goes
+	// down if confirm_votes of them hit. 0 samples = two-poll debounce.
+	int confirm_samples = 4;
+	int confirm_votes = 3;
+	int confirm_gap_us = 300;
+	// Touch-up: report the release at most release_max_ms after the first
+	// low (or unreadable) sample, and at most release_timeout_ms after the
+	// last good one when samples stop arriving.
+	int release_max_ms = 15;
+	int release_timeout_ms = 100;
+
+	int max_delta_px = 0; // 0 disables
+
+	// Optional PENIRQ line (GPIO chardev). -1 keeps plain poll_us polling.
+	std::string penirq_chip = "/dev/gpiochip0";
+	int penirq_line = -1;
+
+	// CPU to pin the acquisition thread to (-1 = no pinning).
+	int acq_cpu = -1;
+
+	// Position fuzz advertised by the uinput device: -1 = derive it from the
+	// measured stationary noise, 0 = none, > 0 = fixed in px.
+	int abs_fuzz = -1;
+	// Visible panel size; sets the ABS resolution (px/mm). 0 = unknown.
+	int panel_width_mm = 0;
+	int panel_height_mm = 0;
+
+	// Control socket of the uinput daemon (empty = off).
+	std::string ctl_socket = "/run/xpt2046/ctl";
+	// Shared-memory sample feed written by the daemon and the calibrator
+	// (empty = off). The GUIs read it instead of parsing calibrator output.
+	std::string feed_shm = "/dev/shm/xpt2046-feed";
+
+	// Calibrator gesture classification.
+	int tap_max_ms = 250;
+	int tap_max_move_px = 12;
+	int drag_start_px = 18;
+};
+
+// Everything load_config() reads, in one place. The daemon compiles it into
+// snapshots; the control socket edits it key by key.
+struct ConfigValues {
+	int invert_x = 0, invert_y = 0, swap_xy = 0;
+	int min_x = 0, max_x = 4095, min_y = 0, max_y = 4095;
+	AdvancedParams adv;
+	std::string path; // file it was read from; empty = defaults
+	std::string spi_device;
+};
+
+// Single key by its touch_config.txt name. set_config_value() returns false
+// for an unknown key or a number that does not parse (v is left unchanged).
+bool set_config_value(ConfigValues& v, const std::string& key, const std::string& val);
+bool get_config_value(const ConfigValues& v, const std::string& key, std::string& out);
+// All keys the file may hold, in file order.
+std::vector<std::string> config_keys();
+
+// Resets invert/swap/ranges to their defaults, then reads usedPath =
+// find_config_path(). Keys missing from the file keep their current value.
+void load_config(int& invert_x, int& invert_y, int& swap_xy,
+				 int& min_x, int& max_x, int& min_y, int& max_y,
+				 AdvancedParams& adv,
+				 std::string& usedPath,
+				 std::string& spi_device_cfg);
+
+void apply_env_overrides(int& invert_x, int& invert_y, int& swap_xy,
+						 int& min_x, int& max_x, int& min_y, int& max_y,
+						 AdvancedParams& adv,
+						 std::string& spi_device_cfg);
+
+// Clamp everything into the ranges the pipeline supports.
+void sanitize_adv(AdvancedParams& adv);
+
+// Warns on stderr and ignores affine/mesh strings that do not parse.
+MappingParams mapping_params(int invert_x, int invert_y, int swap_xy,
+							 int min_x, int max_x, int min_y, int max_y,
+							 const AdvancedParams& adv);
+FilterParams filter_params(const AdvancedParams& adv);
+
+// Replace key=value (or append it), keeping every other line. The file is
+// replaced atomically by renaming a rewritten copy over it.
+bool update_config_key(const std::string& cfgPath, const std::string& key, const std::string& value);
+// Same for several keys in one rename.
+bool update_config_keys(const std::string& cfgPath, const std::vector<std::pair<std::string, std::string>>& kv);
+
+// existingCfg if set, else installation/touch_config.txt next to the build dir.
+std::string default_config_save_path(const std::string& existingCfg);
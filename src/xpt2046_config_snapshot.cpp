@@ -0,0 +1,18 @@
+#include "xpt2046_config_snapshot.h"
+
+std::unique_ptr<ConfigSnapshot> compile_config_snapshot(const ConfigValues& v) {
+	std::unique_ptr<ConfigSnapshot> s(new ConfigSnapshot());
+	static_cast<ConfigValues&>(*s) = v;
+	s->mapper.build(mapping_params(s->invert_x, s->invert_y, s->swap_xy, s->min_x, s->max_x, s->min_y, s->max_y, s->adv));
+	s->filters = filter_params(s->adv);
+	s->fresh_chain = make_filter_chain(s->filters);
+	return s;
+}
+
+std::unique_ptr<ConfigSnapshot> load_config_snapshot() {
+	ConfigValues v;
+	load_config(v.invert_x, v.invert_y, v.swap_xy, v.min_x, v.max_x, v.min_y, v.max_y, v.adv, v.path, v.spi_device);
+	apply_env_overrides(v.invert_x, v.invert_y, v.swap_xy, v.min_x, v.max_x, v.min_y, v.max_y, v.adv, v.spi_device);
+	sanitize_adv(v.adv);
+	return compile_config_snapshot(v);
+}
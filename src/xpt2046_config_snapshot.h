@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+#include "xpt2046_config.h"
+#include "xpt2046_mapping.h"
+#include "xpt2046_pipeline.h"
+
+// touch_config.txt compiled for the sample path: the parsed values, the
+// raw-to-screen tables and the filter coefficients. Built away from the
+// processing thread and not modified once published.
+struct ConfigSnapshot : ConfigValues {
+	uint64_t generation = 0;
+
+	ScreenMapper mapper;
+	FilterParams filters;
+	// A chain built for filters, so installing the snapshot never allocates.
+	// The reader keeps its running chain (and its state) when the names
+	// match and only reconfigures it; otherwise it adopts this one.
+	std::unique_ptr<FilterChain> fresh_chain;
+};
+
+// Builds the tables and chain for already sanitized values.
+std::unique_ptr<ConfigSnapshot> compile_config_snapshot(const ConfigValues& v);
+
+// load_config + XPT_* overrides + sanitize_adv, then compile.
+std::unique_ptr<ConfigSnapshot> load_config_snapshot();
+
+// One-slot handoff from the config producers to the single reader, through
+// one atomic pointer. post() replaces a snapshot that was not taken yet;
+// take() returns the newest one or nullptr. The reader owns what it took,
+// so nothing it still uses can be freed under it.
+class SnapshotMailbox {
+public:
+	SnapshotMailbox() = default;
+	~SnapshotMailbox() { delete slot_.exchange(nullptr); }
+	SnapshotMailbox(const SnapshotMailbox&) = delete;
+	SnapshotMailbox& operator=(const SnapshotMailbox&) = delete;
+
+	void post(std::unique_ptr<ConfigSnapshot> s) { delete slot_.exchange(s.release(), std::memory_order_acq_rel); }
+	std::unique_ptr<ConfigSnapshot> take() {
+		if (!slot_.load(std::memory_order_relaxed)) return nullptr;
+		return std::unique_ptr<ConfigSnapshot>(slot_.exchange(nullptr, std::memory_order_acq_rel));
+	}
+
+private:
+	std::atomic<ConfigSnapshot*> slot_{nullptr};
+};
+
+// Front of the mailbox for every producer (file reloads, the control
+// socket): numbers the snapshots, remembers the newest values so edits
+// start from them, and wakes the reader through notify_fd.
+class SnapshotPublisher {
+public:
+	SnapshotPublisher(SnapshotMailbox& mailbox, int notify_fd, const ConfigValues& initial)
+		: mailbox_(mailbox), notify_fd_(notify_fd), latest_(initial) {}
+
+	// Returns the generation given to s.
+	uint64_t publish(std::unique_ptr<ConfigSnapshot> s) {
+		std::lock_guard<std::mutex> lock(mu_);
+		return publish_locked(std::move(s));
+	}
+
+	// Copy the newest values, let edit change them (false = abort, nothing
+	// published), sanitize, compile and publish, all under one lock so two
+	// concurrent edits cannot lose each other. 0 if aborted.
+	template <typename Fn>
+	uint64_t edit(Fn&& edit_fn) {
+		std::lock_guard<std::mutex> lock(mu_);
+		ConfigValues v = latest_;
+		if (!edit_fn(v)) return 0;
+		sanitize_adv(v.adv);
+		return publish_locked(compile_config_snapshot(v));
+	}
+
+	ConfigValues latest() const {
+		std::lock_guard<std::mutex> lock(mu_);
+		return latest_;
+	}
+
+private:
+	uint64_t publish_locked(std::unique_ptr<ConfigSnapshot> s) {
+		s->generation = ++generation_;
+		latest_ = *s;
+		const uint64_t gen = s->generation;
+		mailbox_.post(std::move(s));
+		uint64_t one = 1;
+		(void)write(notify_fd_, &one, sizeof(one));
+		return gen;
+	}
+
+	SnapshotMailbox& mailbox_;
+	int notify_fd_;
+	mutable std::mutex mu_;
+	ConfigValues latest_;
+	uint64_t generation_ = 0;
+};
@@ -0,0 +1,131 @@
+#include "xpt2046_config_watch.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Writes in place end with IN_CLOSE_WRITE, atomic saves with IN_MOVED_TO.
+const uint32_t kMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB;
+
+void split_path(const std::string& path, std::string& dir, std::string& name) {
+	const size_t pos = path.find_last_of('/');
+	if (pos == std::string::npos) {
+		dir = ".";
+		name = path;
+	} else {
+		dir = pos == 0 ? std::string("/") : path.substr(0, pos);
+		name = path.substr(pos + 1);
+	}
+}
+
+} // namespace
+
+ConfigWatch::~ConfigWatch() {
+	if (fd_ >= 0) close(fd_);
+}
+
+bool ConfigWatch::open(const std::vector<std::string>& paths, std::string& err) {
+	fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd_ < 0) {
+		err = std::string("inotify_init1: ") + std::strerror(errno);
+		return false;
+	}
+	paths_ = paths;
+	for (const auto& p : paths) {
+		std::string dir, name;
+		split_path(p, dir, name);
+		(void)add(dir, name, false); // directory missing or unreadable
+	}
+	if (watches_.empty()) {
+		err = "no config directory could be watched";
+		close(fd_);
+		fd_ = -1;
+		return false;
+	}
+	watch_targets();
+	return true;
+}
+
+bool ConfigWatch::add(const std::string& dir, const std::string& name, bool target) {
+	const int wd = inotify_add_watch(fd_, dir.c_str(), kMask);
+	if (wd < 0) return false;
+	for (auto& w : watches_) {
+		// The kernel hands out one wd per inode, so "build/../installation"
+		// and "installation" share an entry.
+		if (w.wd != wd) continue;
+		(target ? w.targets : w.names).push_back(name);
+		return true;
+	}
+	watches_.push_back(Watch{wd, dir, {}, {}});
+	(target ? watches_.back().targets : watches_.back().names).push_back(name);
+	return true;
+}
+
+void ConfigWatch::watch_targets() {
+	for (auto& w : watches_) w.targets.clear();
+	for (const auto& p : paths_) {
+		struct stat st;
+		if (lstat(p.c_str(), &st) != 0 || !S_ISLNK(st.st_mode)) continue;
+		char* rp = realpath(p.c_str(), nullptr);
+		if (!rp) continue; // dangling link
+		std::string dir, name;
+		split_path(rp, dir, name);
+		free(rp);
+		(void)add(dir, name, true);
+	}
+	// Drop directories that were only watched for a link target.
+	for (size_t i = 0; i < watches_.size();) {
+		if (!watches_[i].names.empty() || !watches_[i].targets.empty()) {
+			++i;
+			continue;
+		}
+		(void)inotify_rm_watch(fd_, watches_[i].wd);
+		watches_.erase(watches_.begin() + (long)i);
+	}
+}
+
+bool ConfigWatch::changed() {
+	if (fd_ < 0) return false;
+	alignas(inotify_event) char buf[4096];
+	bool hit = false;
+	for (;;) {
+		const ssize_t n = read(fd_, buf, sizeof(buf));
+		if (n <= 0) break; // EAGAIN: drained
+		for (ssize_t off = 0; off < n;) {
+			const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + off);
+			off += (ssize_t)(sizeof(inotify_event) + ev->len);
+			if (ev->mask & IN_Q_OVERFLOW) {
+				hit = true;
+				continue;
+			}
+			if (ev->len == 0) continue;
+			for (const auto& w : watches_) {
+				if (w.wd != ev->wd) continue;
+				for (const auto& name : w.names) {
+					if (name == ev->name) hit = true;
+				}
+				for (const auto& name : w.targets) {
+					if (name == ev->name) hit = true;
+				}
+			}
+		}
+	}
+	// A replaced or retargeted link moves the file to watch.
+	if (hit) watch_targets();
+	return hit;
+}
+
+std::string ConfigWatch::describe() const {
+	if (fd_ < 0) return "off";
+	std::string s = "inotify:";
+	for (size_t i = 0; i < watches_.size(); ++i) {
+		if (i) s += ",";
+		s += watches_[i].dir;
+	}
+	return s;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// inotify watch on the directories that may hold touch_config.txt, so the
+// daemon reloads only when a candidate file is written, renamed into place
+// (atomic saves), or removed. Watching the directories rather than the file
+// keeps working across renames and catches a config that appears later.
+// A candidate that is a symlink is saved at its target (update_config_keys
+// renames next to realpath()), so the target's directory is watched too and
+// re-resolved whenever a watched name changes.
+class ConfigWatch {
+public:
+	ConfigWatch() = default;
+	~ConfigWatch();
+	ConfigWatch(const ConfigWatch&) = delete;
+	ConfigWatch& operator=(const ConfigWatch&) = delete;
+
+	// Watch the directory of every path that exists. False (err filled) if
+	// inotify is unavailable or no directory could be watched; the caller
+	// then falls back to polling.
+	bool open(const std::vector<std::string>& paths, std::string& err);
+
+	// Non-blocking descriptor to poll for POLLIN; -1 when not open.
+	int fd() const { return fd_; }
+
+	// Drain the queued events. True if any of them touched a watched file
+	// name or link target (or the queue overflowed, in which case anything
+	// may have changed).
+	bool changed();
+
+	// Human-readable summary for logs.
+	std::string describe() const;
+
+private:
+	struct Watch {
+		int wd;
+		std::string dir;
+		std::vector<std::string> names;
+		std::vector<std::string> targets; // resolved symlink targets
+	};
+
+	bool add(const std::string& dir, const std::string& name, bool target);
+	// Point the target watches at what the symlinked candidates resolve to now.
+	void watch_targets();
+
+	int fd_ = -1;
+	std::vector<std::string> paths_;
+	std::vector<Watch> watches_;
+};
@@ -0,0 +1,116 @@
+// End-to-end micro-benchmark of the per-sample path the daemon runs: burst
+// decode, raw-to-screen mapping and the filter chain, built from the same
+// touch_config.txt and XPT_* overrides through the same library calls.
+// Usage: xpt2046_core_bench [--device sim[:...]|replay:<file>] [--frames N] [--passes N]
+//
+// Frames are captured once from the simulated (or replayed) transport, then
+// mapped and filtered repeatedly so the numbers exclude the simulator.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xpt2046_config.h"
+#include "xpt2046_mapping.h"
+#include "xpt2046_pipeline.h"
+#include "xpt2046_transport.h"
+
+static double ns_since(std::chrono::steady_clock::time_point t0, long long n) {
+	auto t1 = std::chrono::steady_clock::now();
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)std::max(1LL, n);
+}
+
+int main(int argc, char** argv) {
+	std::string device = "sim:stroke=circle,step_us=5000";
+	int frames = 20000;
+	int passes = 200;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) device = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--passes") == 0 && i + 1 < argc) passes = std::max(1, atoi(argv[++i]));
+	}
+
+	int invert_x = 0, invert_y = 0, swap_xy = 0;
+	int min_x = 0, max_x = 4095, min_y = 0, max_y = 4095;
+	AdvancedParams adv;
+	std::string cfgPath;
+	std::string spi_device_cfg;
+	load_config(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, cfgPath, spi_device_cfg);
+	apply_env_overrides(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, spi_device_cfg);
+	sanitize_adv(adv);
+
+	std::string err;
+	std::unique_ptr<SpiTransport> spi = open_transport(device, err);
+	if (!spi || !is_virtual_transport(device)) {
+		std::fprintf(stderr, "[ERROR] --device must be a sim or replay spec (%s)\n", err.c_str());
+		return 1;
+	}
+
+	std::vector<Xpt2046Frame> raw((size_t)frames);
+	auto t0 = std::chrono::steady_clock::now();
+	for (auto& f : raw) read_xpt2046_burst(*spi, adv.burst_xy, adv.burst_z, adv.burst_reduce, f);
+	const double burst_ns = ns_since(t0, frames);
+
+	ScreenMapper mapper;
+	t0 = std::chrono::steady_clock::now();
+	mapper.build(mapping_params(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv));
+	const double build_ns = ns_since(t0, 1);
+	std::unique_ptr<FilterChain> filters = make_filter_chain(filter_params(adv));
+
+	// Only samples the daemon would filter: valid and above press_threshold.
+	std::vector<Xpt2046Frame> touched;
+	for (const auto& f : raw) {
+		if (f.x >= 0 && f.y >= 0 && f.z1 >= std::max(1, adv.press_threshold)) touched.push_back(f);
+	}
+	if (touched.empty()) {
+		std::fprintf(stderr, "[ERROR] No touching frames (press_threshold %d).\n", adv.press_threshold);
+		return 1;
+	}
+	const long long n = (long long)touched.size() * passes;
+	const int64_t step_ns = 5000000;
+
+	int64_t sink = 0;
+	t0 = std::chrono::steady_clock::now();
+	for (int p = 0; p < passes; ++p) {
+		for (const auto& f : touched) {
+			int sx = 0, sy = 0;
+			mapper.map(f.x, f.y, sx, sy);
+			sink += sx + sy;
+		}
+	}
+	const double map_ns = ns_since(t0, n);
+
+	t0 = std::chrono::steady_clock::now();
+	int64_t t_ns = 0;
+	for (int p = 0; p < passes; ++p) {
+		filters->reset();
+		for (const auto& f : touched) {
+			int sx = 0, sy = 0;
+			mapper.map(f.x, f.y, sx, sy);
+			FilterSample s;
+			s.x = sx;
+			s.y = sy;
+			s.t_ns = (t_ns += step_ns);
+			filters->process(s);
+			sink += s.x + s.y;
+		}
+	}
+	const double total_ns = ns_since(t0, n);
+
+	std::printf("cfg:         %s\n", cfgPath.empty() ? "<none>" : cfgPath.c_str());
+	std::printf("device:      %s, %d frames (%zu touching) x %d passes\n", spi->name().c_str(), frames, touched.size(), passes);
+	std::printf("mapping:     %s%s, filters=%s, burst=%d/%d\n", adv.affine.empty() ? "minmax" : "affine",
+				adv.mesh.empty() ? "" : "+mesh", filters->name(), adv.burst_xy, adv.burst_z);
+	std::printf("burst read:  %.1f ns/frame (includes the transport)\n", burst_ns);
+	std::printf("table build: %.1f us\n", build_ns / 1000.0);
+	std::printf("map:         %.2f ns/sample\n", map_ns);
+	std::printf("map+filter:  %.2f ns/sample\n", total_ns);
+	std::printf("checksum:    %lld\n", (long long)sink);
+	return 0;
+}
@@ -0,0 +1,340 @@
+#include "xpt2046_ctl.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "xpt2046_touch_state.h"
+
+namespace {
+
+// A subscriber that stops reading loses samples beyond this, not memory.
+const size_t kMaxClientBacklog = 1 << 20;
+const size_t kMaxLineLength = 64 * 1024;
+
+const char* state_name(uint8_t s) {
+	switch ((TouchState)s) {
+	case TouchState::Idle: return "idle";
+	case TouchState::Confirming: return "confirming";
+	case TouchState::Down: return "down";
+	case TouchState::Releasing: return "releasing";
+	}
+	return "?";
+}
+
+std::vector<std::string> split_words(const std::string& line) {
+	std::vector<std::string> words;
+	std::istringstream is(line);
+	std::string w;
+	while (is >> w) words.push_back(w);
+	return words;
+}
+
+} // namespace
+
+ControlServer::ControlServer(SnapshotPublisher& publisher, int processing_notify_fd)
+	: publisher_(publisher), processing_notify_fd_(processing_notify_fd) {}
+
+ControlServer::~ControlServer() {
+	stop();
+}
+
+bool ControlServer::open(const std::string& path, std::string& err) {
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+		err = "bad socket path";
+		return false;
+	}
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+	const size_t slash = path.find_last_of('/');
+	if (slash != std::string::npos && slash > 0) {
+		const std::string dir = path.substr(0, slash);
+		if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+			err = "mkdir " + dir + ": " + std::strerror(errno);
+			return false;
+		}
+	}
+	// A socket left behind by a previous run would make bind() fail.
+	struct stat st;
+	if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) (void)unlink(path.c_str());
+
+	listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listen_fd_ < 0) {
+		err = std::string("socket: ") + std::strerror(errno);
+		return false;
+	}
+	if (bind(listen_fd_, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd_, 8) != 0) {
+		err = path + ": " + std::strerror(errno);
+		close(listen_fd_);
+		listen_fd_ = -1;
+		return false;
+	}
+	(void)chmod(path.c_str(), 0660);
+	wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	path_ = path;
+	return true;
+}
+
+void ControlServer::start() {
+	if (listen_fd_ < 0 || running_) return;
+	running_ = true;
+	thread_ = std::thread(&ControlServer::run, this);
+}
+
+void ControlServer::stop() {
+	if (running_.exchange(false)) {
+		wake();
+		thread_.join();
+	}
+	for (auto& c : clients_) {
+		if (c.fd >= 0) close(c.fd);
+	}
+	clients_.clear();
+	if (listen_fd_ >= 0) {
+		close(listen_fd_);
+		listen_fd_ = -1;
+		(void)unlink(path_.c_str());
+	}
+	if (wake_fd_ >= 0) {
+		close(wake_fd_);
+		wake_fd_ = -1;
+	}
+}
+
+void ControlServer::post_stats(const std::string& text) {
+	{
+		std::lock_guard<std::mutex> lock(stats_mu_);
+		stats_text_ = text;
+		stats_ready_ = true;
+	}
+	stats_requested_.store(false, std::memory_order_release);
+	wake();
+}
+
+void ControlServer::wake() {
+	if (wake_fd_ < 0) return;
+	uint64_t one = 1;
+	(void)write(wake_fd_, &one, sizeof(one));
+}
+
+void ControlServer::run() {
+	std::vector<pollfd> pfds;
+	while (running_) {
+		pfds.clear();
+		pfds.push_back(pollfd{listen_fd_, POLLIN, 0});
+		pfds.push_back(pollfd{wake_fd_, POLLIN, 0});
+		for (const auto& c : clients_) {
+			pfds.push_back(pollfd{c.fd, (short)(POLLIN | (c.out.empty() ? 0 : POLLOUT)), 0});
+		}
+		// Subscribers are fed from the ring at 100 Hz; the processing thread
+		// never makes a syscall for them.
+		const int timeout_ms = has_subscribers() ? 10 : 500;
+		if (poll(pfds.data(), pfds.size(), timeout_ms) < 0 && errno != EINTR) break;
+
+		if (pfds[1].revents & POLLIN) {
+			uint64_t cnt = 0;
+			(void)read(wake_fd_, &cnt, sizeof(cnt));
+		}
+		for (size_t i = 0; i < clients_.size(); ++i) {
+			Client& c = clients_[i];
+			const short ev = pfds[i + 2].revents;
+			if ((ev & (POLLIN | POLLHUP | POLLERR)) && !read_client(c)) {
+				close(c.fd);
+				c.fd = -1;
+			}
+		}
+		if (pfds[0].revents & POLLIN) accept_clients();
+
+		send_samples();
+		{
+			std::lock_guard<std::mutex> lock(stats_mu_);
+			if (stats_ready_) {
+				for (auto& c : clients_) {
+					if (!c.awaiting_stats) continue;
+					c.out += stats_text_;
+					c.out += "OK\n";
+					c.awaiting_stats = false;
+				}
+				stats_ready_ = false;
+			}
+		}
+		for (auto& c : clients_) {
+			if (c.fd >= 0) handle_lines(c);
+		}
+
+		for (auto& c : clients_) {
+			if (c.fd >= 0 && !flush(c)) {
+				close(c.fd);
+				c.fd = -1;
+			}
+		}
+		for (size_t i = 0; i < clients_.size();) {
+			if (clients_[i].fd >= 0) {
+				++i;
+				continue;
+			}
+			set_subscription(clients_[i], 0);
+			clients_.erase(clients_.begin() + (long)i);
+		}
+	}
+}
+
+void ControlServer::accept_clients() {
+	for (;;) {
+		const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) return;
+		Client c;
+		c.fd = fd;
+		clients_.push_back(c);
+	}
+}
+
+bool ControlServer::read_client(Client& c) {
+	char buf[1024];
+	for (;;) {
+		const ssize_t n = read(c.fd, buf, sizeof(buf));
+		if (n == 0) return false;
+		if (n < 0) return errno == EAGAIN || errno == EINTR;
+		c.in.append(buf, (size_t)n);
+		handle_lines(c);
+		if (c.in.size() > kMaxLineLength) return false;
+	}
+}
+
+void ControlServer::handle_lines(Client& c) {
+	size_t nl;
+	// Answers go out in command order: the lines after "stats" wait for it.
+	while (!c.awaiting_stats && (nl = c.in.find('\n')) != std::string::npos) {
+		std::string line = c.in.substr(0, nl);
+		c.in.erase(0, nl + 1);
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		handle_line(c, line);
+	}
+}
+
+void ControlServer::handle_line(Client& c, const std::string& line) {
+	const std::vector<std::string> words = split_words(line);
+	if (words.empty()) return;
+	const std::string& cmd = words[0];
+
+	if (cmd == "stats") {
+		// Answered once the processing thread has formatted the counters.
+		c.awaiting_stats = true;
+		stats_requested_.store(true, std::memory_order_release);
+		uint64_t one = 1;
+		(void)write(processing_notify_fd_, &one, sizeof(one));
+	} else if (cmd == "get") {
+		const ConfigValues v = publisher_.latest();
+		const std::vector<std::string> keys =
+			words.size() > 1 ? std::vector<std::string>(words.begin() + 1, words.end()) : config_keys();
+		std::string out;
+		for (const auto& k : keys) {
+			std::string val;
+			if (!get_config_value(v, k, val)) {
+				c.out += "ERR unknown key: " + k + "\n";
+				return;
+			}
+			out += k + "=" + val + "\n";
+		}
+		c.out += out + "OK\n";
+	} else if (cmd == "set") {
+		if (words.size() < 2) {
+			c.out += "ERR usage: set key=value [key=value...]\n";
+			return;
+		}
+		std::string bad;
+		const uint64_t gen = publisher_.edit([&](ConfigValues& v) {
+			for (size_t i = 1; i < words.size(); ++i) {
+				const size_t eq = words[i].find('=');
+				if (eq == std::string::npos || !set_config_value(v, words[i].substr(0, eq), words[i].substr(eq + 1))) {
+					bad = words[i];
+					return false;
+				}
+			}
+			return true;
+		});
+		if (gen == 0) {
+			c.out += "ERR unknown key or bad value: " + bad + "\n";
+			return;
+		}
+		for (size_t i = 1; i < words.size(); ++i) unsaved_.insert(words[i].substr(0, words[i].find('=')));
+		c.out += "OK generation=" + std::to_string(gen) + "\n";
+	} else if (cmd == "save") {
+		if (unsaved_.empty()) {
+			c.out += "OK nothing to save\n";
+			return;
+		}
+		// Saved values are the sanitized ones the daemon runs with.
+		const ConfigValues v = publisher_.latest();
+		std::vector<std::pair<std::string, std::string>> kv;
+		for (const auto& k : unsaved_) {
+			std::string val;
+			if (get_config_value(v, k, val)) kv.emplace_back(k, val);
+		}
+		const std::string path = default_config_save_path(v.path);
+		if (!update_config_keys(path, kv)) {
+			c.out += "ERR could not write " + path + "\n";
+			return;
+		}
+		unsaved_.clear();
+		c.out += "OK saved " + std::to_string(kv.size()) + " keys to " + path + "\n";
+	} else if (cmd == "subscribe") {
+		const std::string what = words.size() > 1 ? words[1] : "filtered";
+		if (what != "raw" && what != "filtered") {
+			c.out += "ERR usage: subscribe raw|filtered\n";
+			return;
+		}
+		set_subscription(c, what == "raw" ? 1 : 2);
+		c.out += "OK\n";
+	} else if (cmd == "unsubscribe") {
+		set_subscription(c, 0);
+		c.out += "OK\n";
+	} else if (cmd == "help") {
+		c.out += "stats | get [key...] | set key=value... | save | subscribe raw|filtered | unsubscribe\nOK\n";
+	} else {
+		c.out += "ERR unknown command: " + cmd + "\n";
+	}
+}
+
+void ControlServer::set_subscription(Client& c, int subscription) {
+	if ((c.subscription != 0) == (subscription != 0)) {
+		c.subscription = subscription;
+		return;
+	}
+	subscribers_.fetch_add(subscription != 0 ? 1 : -1, std::memory_order_relaxed);
+	c.subscription = subscription;
+}
+
+void ControlServer::send_samples() {
+	CtlSample s;
+	char line[128];
+	while (samples_.pop(s)) {
+		const int n = std::snprintf(line, sizeof(line), "S %lld %d %d %d %d %d %s\n", (long long)(s.t_ns / 1000),
+									s.raw_x, s.raw_y, s.z1, s.x, s.y, state_name(s.state));
+		for (auto& c : clients_) {
+			if (c.fd < 0 || c.subscription == 0) continue;
+			if (c.subscription == 2 && s.x < 0) continue;
+			if (c.out.size() > kMaxClientBacklog) continue;
+			c.out.append(line, (size_t)n);
+		}
+	}
+}
+
+bool ControlServer::flush(Client& c) {
+	while (!c.out.empty()) {
+		const ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0) return errno == EAGAIN || errno == EINTR;
+		c.out.erase(0, (size_t)n);
+	}
+	return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xpt2046_config_snapshot.h"
+#include "xpt2046_feed.h"
+#include "xpt2046_ring.h"
+
+// One processed sample as subscribers and the sample feed see it. x/y are
+// the emitted (filtered) position, -1 while nothing is emitted; axis_* and
+// screen_* are the mapping stages, -1 for invalid samples.
+struct CtlSample {
+	int64_t t_ns = 0;
+	int raw_x = -1;
+	int raw_y = -1;
+	int z1 = 0;
+	int z2 = 0;
+	int axis_x = -1;
+	int axis_y = -1;
+	int screen_x = -1;
+	int screen_y = -1;
+	int x = -1;
+	int y = -1;
+	uint8_t state = 0; // TouchState
+	uint8_t down = 0;
+};
+
+// The frame the daemon publishes to the sample feed for s.
+inline FeedFrame feed_frame(const CtlSample& s) {
+	FeedFrame f;
+	f.t_ns = s.t_ns;
+	f.raw_x = s.raw_x;
+	f.raw_y = s.raw_y;
+	f.z1 = s.z1;
+	f.z2 = s.z2;
+	f.pressure = s.z1 >= 0 ? s.z1 : 0;
+	f.axis_x = s.axis_x;
+	f.axis_y = s.axis_y;
+	f.screen_x = s.screen_x;
+	f.screen_y = s.screen_y;
+	f.out_x = s.x;
+	f.out_y = s.y;
+	f.down = s.down;
+	f.state = s.state;
+	return f;
+}
+
+// Control socket of the uinput daemon (ctl_socket, default
+// /run/xpt2046/ctl). Line protocol, one command per line, answers end with
+// "OK ..." or "ERR ...":
+//
+//   stats                      the [STATS] lines
+//   get [key...]               key=value for the given (or all) config keys
+//   set key=value [key=value]  apply all of them as one new config
+//   save                       write the keys changed by set to the config file
+//   subscribe raw|filtered     stream "S t_us raw_x raw_y z1 x y state" lines
+//                              (raw: every sample, filtered: emitted ones)
+//   unsubscribe
+//
+// The server runs on its own thread. The processing thread only pushes
+// samples into a lock-free ring and answers stats requests between frames.
+class ControlServer {
+public:
+	ControlServer(SnapshotPublisher& publisher, int processing_notify_fd);
+	~ControlServer();
+	ControlServer(const ControlServer&) = delete;
+	ControlServer& operator=(const ControlServer&) = delete;
+
+	// Create the socket (and its directory), replacing a stale one.
+	bool open(const std::string& path, std::string& err);
+	void start();
+	void stop();
+
+	// Processing thread, allocation-free.
+	bool has_subscribers() const { return subscribers_.load(std::memory_order_relaxed) > 0; }
+	void push_sample(const CtlSample& s) { (void)samples_.push(s); }
+
+	// Processing thread, between frames: a client asked for stats; hand the
+	// formatted lines back with post_stats().
+	bool stats_requested() const { return stats_requested_.load(std::memory_order_acquire); }
+	void post_stats(const std::string& text);
+
+private:
+	struct Client {
+		int fd = -1;
+		std::string in;
+		std::string out;
+		int subscription = 0; // 0 = none, 1 = raw, 2 = filtered
+		bool awaiting_stats = false;
+	};
+
+	void run();
+	void accept_clients();
+	bool read_client(Client& c);
+	void handle_lines(Client& c);
+	void handle_line(Client& c, const std::string& line);
+	void set_subscription(Client& c, int subscription);
+	void send_samples();
+	bool flush(Client& c);
+	void wake();
+
+	SnapshotPublisher& publisher_;
+	int processing_notify_fd_;
+	std::string path_;
+	int listen_fd_ = -1;
+	int wake_fd_ = -1;
+	std::thread thread_;
+	std::atomic<bool> running_{false};
+
+	std::vector<Client> clients_;
+	std::set<std::string> unsaved_; // keys changed by set since the last save
+
+	std::atomic<int> subscribers_{0};
+	SpscRing<CtlSample, 1024> samples_;
+
+	std::atomic<bool> stats_requested_{false};
+	std::mutex stats_mu_;
+	std::string stats_text_;
+	bool stats_ready_ = false;
+};
@@ -0,0 +1,113 @@
+// Command-line client for the daemon's control socket, for scripts that
+// cannot rely on socat:
+//
+//   xpt2046_ctl [--socket path] <command> [args...]
+//
+// The arguments are sent as one command line. Answer lines go to stdout,
+// the closing "OK ..." / "ERR ..." line to stderr, so `get` output can be
+// read as key=value lines. After a successful subscribe the sample lines
+// are printed until the daemon goes away, the client is interrupted or,
+// when stdin is a terminal, Enter is pressed (a signal from a script does
+// not reach a client started through sudo).
+//
+// Exit status: 0 on OK, 1 on ERR, 2 when the daemon is not reachable.
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int connect_socket(const std::string& path) {
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(addr.sun_path)) return -1;
+	std::memcpy(addr.sun_path, path.c_str(), path.size());
+	const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool send_all(int fd, const std::string& s) {
+	size_t off = 0;
+	while (off < s.size()) {
+		const ssize_t n = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		off += (size_t)n;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const char* env = getenv("XPT_CTL_SOCKET");
+	std::string path = env && *env ? env : "/run/xpt2046/ctl";
+	int i = 1;
+	if (i + 1 < argc && std::strcmp(argv[i], "--socket") == 0) {
+		path = argv[i + 1];
+		i += 2;
+	}
+	if (i >= argc) {
+		std::fprintf(stderr, "usage: %s [--socket path] <command> [args...]\n", argv[0]);
+		return 2;
+	}
+	std::string cmd;
+	for (; i < argc; ++i) {
+		if (!cmd.empty()) cmd += ' ';
+		cmd += argv[i];
+	}
+	const bool subscribe = cmd.rfind("subscribe", 0) == 0;
+
+	const int fd = connect_socket(path);
+	if (fd < 0) {
+		std::fprintf(stderr, "[ERROR] %s: %s\n", path.c_str(), std::strerror(errno));
+		return 2;
+	}
+	if (!send_all(fd, cmd + "\n")) {
+		std::fprintf(stderr, "[ERROR] %s: %s\n", path.c_str(), std::strerror(errno));
+		close(fd);
+		return 2;
+	}
+
+	std::string in;
+	int status = -1; // -1 until the answer's closing line arrived
+	char buf[4096];
+	const bool watch_tty = subscribe && isatty(STDIN_FILENO);
+	for (;;) {
+		pollfd pfds[2] = {{fd, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+		if (poll(pfds, watch_tty && status == 0 ? 2 : 1, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (watch_tty && status == 0 && (pfds[1].revents & (POLLIN | POLLHUP))) break;
+		if (!(pfds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+		const ssize_t n = read(fd, buf, sizeof(buf));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		in.append(buf, (size_t)n);
+		size_t nl;
+		while ((nl = in.find('\n')) != std::string::npos) {
+			const std::string line = in.substr(0, nl + 1);
+			in.erase(0, nl + 1);
+			if (status < 0 && (line.rfind("OK", 0) == 0 || line.rfind("ERR", 0) == 0)) {
+				status = line[0] == 'O' ? 0 : 1;
+				std::fputs(line.c_str(), stderr);
+			} else {
+				std::fputs(line.c_str(), stdout);
+			}
+		}
+		std::fflush(stdout);
+		if (status >= 0 && !(subscribe && status == 0)) break;
+	}
+	close(fd);
+	return status < 0 ? 2 : status;
+}
@@ -0,0 +1,234 @@
+#include "xpt2046_feed.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t kMagic = 0x58505446; // "XPTF"
+const uint32_t kVersion = 1;
+const size_t kFrameWords = sizeof(FeedFrame) / sizeof(uint32_t);
+// A reader gives up on a slot the writer keeps rewriting after this many tries.
+const int kReadRetries = 64;
+
+} // namespace
+
+struct FeedSegment {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t frame_size;
+	uint32_t ring_size;
+	alignas(64) std::atomic<uint32_t> head; // frames published so far
+	struct Slot {
+		std::atomic<uint32_t> seq; // odd while the writer is inside
+		uint32_t index;
+		uint32_t words[kFrameWords];
+	};
+	alignas(64) Slot slots[FeedWriter::kRingSize];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the feed needs address-free atomics");
+
+// Frame data goes through relaxed word-sized atomics so a reader racing the
+// writer reads torn but defined values, which the sequence check rejects.
+static void store_words(uint32_t* dst, const void* src) {
+	uint32_t w[kFrameWords];
+	std::memcpy(w, src, sizeof(w));
+	for (size_t i = 0; i < kFrameWords; ++i) __atomic_store_n(&dst[i], w[i], __ATOMIC_RELAXED);
+}
+
+static void load_words(void* dst, const uint32_t* src) {
+	uint32_t w[kFrameWords];
+	for (size_t i = 0; i < kFrameWords; ++i) w[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+	std::memcpy(dst, w, sizeof(w));
+}
+
+FeedWriter::~FeedWriter() {
+	close();
+}
+
+void FeedWriter::close() {
+	// Attached readers see the magic vanish and let go of the segment.
+	if (seg_) {
+		__atomic_store_n(&seg_->magic, 0u, __ATOMIC_RELEASE);
+		munmap(seg_, sizeof(FeedSegment));
+	}
+	seg_ = nullptr;
+	if (fd_ >= 0) ::close(fd_); // drops the writer lock
+	fd_ = -1;
+}
+
+static bool fail(std::string& err, const std::string& path, const char* what, int fd = -1) {
+	err = path + ": " + what;
+	if (fd >= 0) ::close(fd);
+	return false;
+}
+
+// Lock the segment currently at path and make sure it is ours to replace.
+// Returns the locked descriptor, -1 when nothing is there, or -2 on error.
+static int lock_previous(const std::string& path, std::string& err) {
+	for (int attempt = 0; attempt < 8; ++attempt) {
+		const int fd = ::open(path.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+		if (fd < 0) {
+			if (errno == ENOENT) return -1;
+			fail(err, path, std::strerror(errno));
+			return -2;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+			fail(err, path, "not a regular file", fd);
+			return -2;
+		}
+		if (st.st_uid != geteuid()) {
+			fail(err, path, ("owned by uid " + std::to_string(st.st_uid)).c_str(), fd);
+			return -2;
+		}
+		if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+			fail(err, path, errno == EWOULDBLOCK ? "another writer is running" : std::strerror(errno), fd);
+			return -2;
+		}
+		// The previous writer may have replaced the file between our open
+		// and the lock; only the file still at path is ours to remove.
+		struct stat now;
+		if (lstat(path.c_str(), &now) == 0 && now.st_dev == st.st_dev && now.st_ino == st.st_ino) return fd;
+		::close(fd);
+	}
+	fail(err, path, "keeps changing");
+	return -2;
+}
+
+bool FeedWriter::open(const std::string& path, std::string& err) {
+	close();
+	// The segment is always a fresh file of ours: the old one is locked
+	// (failing while another writer holds it), unlinked and recreated with
+	// O_EXCL, so nothing someone else planted at path is ever written to.
+	const int prev = lock_previous(path, err);
+	if (prev == -2) return false;
+	if (prev >= 0) {
+		// Readers still attached to the old file let go of it.
+		void* old = mmap(nullptr, sizeof(FeedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, prev, 0);
+		struct stat st;
+		if (old != MAP_FAILED) {
+			if (fstat(prev, &st) == 0 && (size_t)st.st_size >= sizeof(FeedSegment))
+				__atomic_store_n(&static_cast<FeedSegment*>(old)->magic, 0u, __ATOMIC_RELEASE);
+			munmap(old, sizeof(FeedSegment));
+		}
+		if (unlink(path.c_str()) != 0) return fail(err, path, std::strerror(errno), prev);
+	}
+	const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+	if (prev >= 0) ::close(prev);
+	if (fd < 0) return fail(err, path, errno == EEXIST ? "another writer is running" : std::strerror(errno));
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) return fail(err, path, "another writer is running", fd);
+	if (ftruncate(fd, (off_t)sizeof(FeedSegment)) != 0) return fail(err, path, std::strerror(errno), fd);
+	void* p = mmap(nullptr, sizeof(FeedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) return fail(err, path, std::strerror(errno), fd);
+	seg_ = static_cast<FeedSegment*>(p);
+	fd_ = fd;
+
+	// The file starts zeroed; the magic goes last so a reader never maps a
+	// half-initialized header.
+	seg_->version = kVersion;
+	seg_->frame_size = (uint32_t)sizeof(FeedFrame);
+	seg_->ring_size = kRingSize;
+	__atomic_store_n(&seg_->magic, kMagic, __ATOMIC_RELEASE);
+	return true;
+}
+
+void FeedWriter::publish(const FeedFrame& f) {
+	if (!seg_) return;
+	const uint32_t h = seg_->head.load(std::memory_order_relaxed);
+	FeedSegment::Slot& s = seg_->slots[h % kRingSize];
+	const uint32_t seq = s.seq.load(std::memory_order_relaxed);
+	s.seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	__atomic_store_n(&s.index, h, __ATOMIC_RELAXED);
+	store_words(s.words, &f);
+	s.seq.store(seq + 2, std::memory_order_release);
+	seg_->head.store(h + 1, std::memory_order_release);
+}
+
+FeedReader::~FeedReader() {
+	close();
+}
+
+bool FeedReader::open(const std::string& path) {
+	close();
+	const int fd = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FeedSegment)) {
+		::close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, sizeof(FeedSegment), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) return false;
+	const FeedSegment* seg = static_cast<const FeedSegment*>(p);
+	if (__atomic_load_n(&seg->magic, __ATOMIC_ACQUIRE) != kMagic || seg->version != kVersion ||
+		seg->frame_size != sizeof(FeedFrame) || seg->ring_size != FeedWriter::kRingSize) {
+		munmap(p, sizeof(FeedSegment));
+		return false;
+	}
+	seg_ = seg;
+	cursor_ = seg_->head.load(std::memory_order_acquire);
+	return true;
+}
+
+void FeedReader::close() {
+	if (seg_) munmap(const_cast<FeedSegment*>(seg_), sizeof(FeedSegment));
+	seg_ = nullptr;
+}
+
+uint32_t FeedReader::published() const {
+	return seg_ ? seg_->head.load(std::memory_order_acquire) : 0;
+}
+
+bool FeedReader::read_slot(uint32_t index, FeedFrame& out) const {
+	const FeedSegment::Slot& s = seg_->slots[index % FeedWriter::kRingSize];
+	for (int i = 0; i < kReadRetries; ++i) {
+		const uint32_t s1 = s.seq.load(std::memory_order_acquire);
+		if (s1 & 1) continue;
+		const uint32_t idx = __atomic_load_n(&s.index, __ATOMIC_RELAXED);
+		load_words(&out, s.words);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (s.seq.load(std::memory_order_relaxed) != s1) continue;
+		// A newer frame in the slot means this one was overwritten.
+		return idx == index;
+	}
+	return false;
+}
+
+bool FeedReader::writer_gone() {
+	if (!seg_ || __atomic_load_n(&seg_->magic, __ATOMIC_ACQUIRE) == kMagic) return false;
+	close();
+	return true;
+}
+
+bool FeedReader::latest(FeedFrame& out) {
+	if (!seg_ || writer_gone()) return false;
+	for (int i = 0; i < kReadRetries; ++i) {
+		const uint32_t h = seg_->head.load(std::memory_order_acquire);
+		if (h == 0) return false;
+		if (read_slot(h - 1, out)) return true;
+	}
+	return false;
+}
+
+size_t FeedReader::read_new(FeedFrame* out, size_t max) {
+	if (!seg_ || writer_gone()) return 0;
+	const uint32_t h = seg_->head.load(std::memory_order_acquire);
+	// The writer restarted (head went back) or got more than a ring ahead.
+	if ((int32_t)(h - cursor_) < 0) cursor_ = h;
+	if (h - cursor_ > FeedWriter::kRingSize) cursor_ = h - FeedWriter::kRingSize;
+	size_t n = 0;
+	while (cursor_ != h && n < max) {
+		if (read_slot(cursor_, out[n])) n++;
+		cursor_++;
+	}
+	return n;
+}
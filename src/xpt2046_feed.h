@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Sample feed in shared memory (a file under /dev/shm, feed_shm in the
+// config). The process that reads the panel publishes every frame into a
+// ring of recent frames; any number of readers map the file read-only and
+// copy frames out without ever blocking or being seen by the writer.
+//
+// Each ring slot is a seqlock: the writer makes the sequence odd, stores
+// the frame and makes it even again. A reader that saw an odd or changed
+// sequence around its copy retries. The newest slot is the latest frame.
+
+// One published frame. Positions that were not computed are -1.
+struct FeedFrame {
+	int64_t t_ns = 0; // CLOCK_MONOTONIC (daemon) or steady_clock (calibrator)
+	int32_t raw_x = -1;
+	int32_t raw_y = -1;
+	int32_t z1 = 0;
+	int32_t z2 = 0;
+	int32_t pressure = 0;
+	int32_t axis_x = -1; // raw after swap/invert/clamp
+	int32_t axis_y = -1;
+	int32_t screen_x = -1; // mapped, before the filters
+	int32_t screen_y = -1;
+	int32_t out_x = -1; // filtered output position
+	int32_t out_y = -1;
+	uint8_t down = 0;
+	uint8_t dragging = 0;
+	uint8_t state = 0; // TouchState (daemon)
+	uint8_t reserved = 0;
+	uint32_t gestures = 0; // number of gestures so far; gesture holds the last
+	char gesture[32] = {};
+};
+
+static_assert(sizeof(FeedFrame) % sizeof(uint32_t) == 0, "FeedFrame is copied in 32-bit words");
+
+struct FeedSegment;
+
+class FeedWriter {
+public:
+	static constexpr uint32_t kRingSize = 256;
+
+	FeedWriter() = default;
+	~FeedWriter();
+	FeedWriter(const FeedWriter&) = delete;
+	FeedWriter& operator=(const FeedWriter&) = delete;
+
+	// Replace the segment at path with a new one and hold it locked until
+	// close(). Fails while another writer holds path, or when the file there
+	// is not a regular file of this user.
+	bool open(const std::string& path, std::string& err);
+	bool is_open() const { return seg_ != nullptr; }
+	void close();
+
+	// Allocation- and syscall-free.
+	void publish(const FeedFrame& f);
+
+private:
+	FeedSegment* seg_ = nullptr;
+	int fd_ = -1;
+};
+
+class FeedReader {
+public:
+	FeedReader() = default;
+	~FeedReader();
+	FeedReader(const FeedReader&) = delete;
+	FeedReader& operator=(const FeedReader&) = delete;
+
+	// Map an existing segment; false while the writer has not created it yet.
+	bool open(const std::string& path);
+	bool is_open() const { return seg_ != nullptr; }
+	void close();
+
+	// Newest frame; false if nothing was published yet. Both readers close
+	// the segment once its writer has gone, so is_open() turns false and the
+	// caller can wait for the next writer with open().
+	bool latest(FeedFrame& out);
+	// Frames published since the previous call, oldest first, at most max.
+	// Frames the writer overwrote before they were read are skipped.
+	size_t read_new(FeedFrame* out, size_t max);
+	uint32_t published() const;
+
+private:
+	bool read_slot(uint32_t index, FeedFrame& out) const;
+	bool writer_gone();
+
+	const FeedSegment* seg_ = nullptr;
+	uint32_t cursor_ = 0;
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+// Largest median_window accepted by the config (0, 3, 5, 7 or 9).
+constexpr int kMaxMedianWindow = 9;
+
+// Compare-exchange: afterwards a <= b. min/max compile to branch-free code.
+inline void cmp_swap(int& a, int& b) {
+	const int lo = std::min(a, b);
+	const int hi = std::max(a, b);
+	a = lo;
+	b = hi;
+}
+
+// Median of exactly N values via a fixed selection network. v is scratch and
+// gets partially ordered. Only the odd sizes we accept are specialized.
+template <int N>
+int median_network(int* v);
+
+template <>
+inline int median_network<3>(int* v) {
+	cmp_swap(v[0], v[1]);
+	cmp_swap(v[1], v[2]);
+	cmp_swap(v[0], v[1]);
+	return v[1];
+}
+
+template <>
+inline int median_network<5>(int* v) {
+	cmp_swap(v[0], v[1]);
+	cmp_swap(v[3], v[4]);
+	cmp_swap(v[0], v[3]);
+	cmp_swap(v[1], v[4]);
+	cmp_swap(v[1], v[2]);
+	cmp_swap(v[2], v[3]);
+	cmp_swap(v[1], v[2]);
+	return v[2];
+}
+
+template <>
+inline int median_network<7>(int* v) {
+	cmp_swap(v[0], v[5]);
+	cmp_swap(v[0], v[3]);
+	cmp_swap(v[1], v[6]);
+	cmp_swap(v[2], v[4]);
+	cmp_swap(v[0], v[1]);
+	cmp_swap(v[3], v[5]);
+	cmp_swap(v[2], v[6]);
+	cmp_swap(v[2], v[3]);
+	cmp_swap(v[3], v[6]);
+	cmp_swap(v[4], v[5]);
+	cmp_swap(v[1], v[4]);
+	cmp_swap(v[1], v[3]);
+	cmp_swap(v[3], v[4]);
+	return v[3];
+}
+
+template <>
+inline int median_network<9>(int* v) {
+	cmp_swap(v[1], v[2]);
+	cmp_swap(v[4], v[5]);
+	cmp_swap(v[7], v[8]);
+	cmp_swap(v[0], v[1]);
+	cmp_swap(v[3], v[4]);
+	cmp_swap(v[6], v[7]);
+	cmp_swap(v[1], v[2]);
+	cmp_swap(v[4], v[5]);
+	cmp_swap(v[7], v[8]);
+	cmp_swap(v[0], v[3]);
+	cmp_swap(v[5], v[8]);
+	cmp_swap(v[4], v[7]);
+	cmp_swap(v[3], v[6]);
+	cmp_swap(v[1], v[4]);
+	cmp_swap(v[2], v[5]);
+	cmp_swap(v[4], v[7]);
+	cmp_swap(v[4], v[2]);
+	cmp_swap(v[6], v[4]);
+	cmp_swap(v[4], v[2]);
+	return v[4];
+}
+
+// Runtime dispatch on the number of values. Odd sizes up to 9 use the
+// networks; anything else (even counts while a window is filling) falls back
+// to nth_element, which gives the upper median.
+inline int median_select(int* v, int n) {
+	switch (n) {
+	case 0: return 0;
+	case 1: return v[0];
+	case 3: return median_network<3>(v);
+	case 5: return median_network<5>(v);
+	case 7: return median_network<7>(v);
+	case 9: return median_network<9>(v);
+	default:
+		std::nth_element(v, v + n / 2, v + n);
+		return v[n / 2];
+	}
+}
+
+// Sliding window over the newest samples, kept in a fixed ring so the
+// per-sample path never touches the heap. N is the largest window accepted.
+template <size_t N>
+class MedianWindow {
+public:
+	void clear() {
+		size_ = 0;
+		head_ = 0;
+	}
+
+	void push(int v) {
+		buf_[head_] = v;
+		// A compare instead of % N: N = 5, 7 or 9 would cost a multiply.
+		if (++head_ == N) head_ = 0;
+		if (size_ < N) size_++;
+	}
+
+	// Median of the newest min(window, size) values (upper median when even),
+	// computed on a stack copy.
+	int median(int window) const {
+		size_t n = std::min(size_, (size_t)std::max(window, 0));
+		int tmp[N];
+		for (size_t i = 0; i < n; ++i) tmp[i] = buf_[(head_ + N - 1 - i) % N];
+		return median_select(tmp, (int)n);
+	}
+
+	size_t size() const { return size_; }
+
+	// Median of the whole ring once it is full, with the network for N
+	// inlined (sample order does not matter for a median).
+	template <int W>
+	int median_full() const {
+		static_assert((size_t)W == N, "window must match the ring size");
+		return median_full_impl<W>(std::make_index_sequence<N>());
+	}
+
+private:
+	// Element-wise init rather than a copy loop: GCC vectorizes the loop into
+	// a 16-byte stack store that the network then reads back as scalars,
+	// which stalls store forwarding and made median5 slower than the generic
+	// chain.
+	template <int W, size_t... I>
+	int median_full_impl(std::index_sequence<I...>) const {
+		int tmp[N] = {buf_[I]...};
+		return median_network<W>(tmp);
+	}
+
+	int buf_[N] = {};
+	size_t head_ = 0;
+	size_t size_ = 0;
+};
+
+// One Euro filter (Casiez, Roussel, Vogel 2012): a first-order low-pass whose
+// cutoff rises with the smoothed speed, cutoff = min_cutoff + beta * |dx/dt|.
+// A resting finger gets min_cutoff (heavy smoothing), a fast drag a high
+// cutoff (little lag). One instance per axis; units are pixels and seconds.
+class OneEuroFilter {
+public:
+	void configure(float min_cutoff_hz, float beta, float d_cutoff_hz) {
+		min_cutoff_ = min_cutoff_hz;
+		beta_ = beta;
+		d_cutoff_ = d_cutoff_hz;
+	}
+
+	void reset() { have_ = false; }
+
+	// dt_s is the time since the previous sample; non-positive values (equal
+	// timestamps) are treated as 100 us so the filter never divides by zero.
+	float filter(float x, float dt_s) {
+		if (!have_) {
+			x_ = x;
+			dx_ = 0.0f;
+			have_ = true;
+			return x;
+		}
+		if (dt_s <= 0.0f) dt_s = 1e-4f;
+		const float raw_dx = (x - x_) / dt_s;
+		dx_ += alpha(d_cutoff_, dt_s) * (raw_dx - dx_);
+		const float cutoff = min_cutoff_ + beta_ * (dx_ < 0.0f ? -dx_ : dx_);
+		x_ += alpha(cutoff, dt_s) * (x - x_);
+		return x_;
+	}
+
+private:
+	static float alpha(float cutoff_hz, float dt_s) {
+		const float tau = 1.0f / (6.2831853f * cutoff_hz);
+		return 1.0f / (1.0f + tau / dt_s);
+	}
+
+	float min_cutoff_ = 1.0f;
+	float beta_ = 0.0f;
+	float d_cutoff_ = 1.0f;
+	float x_ = 0.0f;
+	float dx_ = 0.0f;
+	bool have_ = false;
+};
+
+// Constant-velocity Kalman tracker for one axis. State is position and
+// velocity; the finger's acceleration is modelled as white noise with
+// standard deviation accel (px/s^2) and each sample as the true position
+// plus noise (px). Besides smoothing, the velocity estimate lets the caller
+// extrapolate a few milliseconds ahead to hide pipeline latency.
+class KalmanTracker {
+public:
+	void configure(float accel_px_s2, float noise_px) {
+		q_ = (double)accel_px_s2 * accel_px_s2;
+		r_ = (double)noise_px * noise_px;
+	}
+
+	void reset() { have_ = false; }
+
+	// Returns the filtered position. dt_s <= 0 is treated as 100 us.
+	float update(float z, float dt_s) {
+		if (!have_) {
+			p_ = z;
+			v_ = 0.0;
+			// Unknown velocity: start wide so the first few samples set it.
+			pp_ = r_;
+			pv_ = 0.0;
+			vv_ = 1e6;
+			have_ = true;
+			return z;
+		}
+		const double dt = dt_s > 0.0f ? dt_s : 1e-4;
+		// Predict.
+		p_ += v_ * dt;
+		const double dt2 = dt * dt;
+		pp_ += dt * (2.0 * pv_ + dt * vv_) + q_ * dt2 * dt2 * 0.25;
+		pv_ += dt * vv_ + q_ * dt2 * dt * 0.5;
+		vv_ += q_ * dt2;
+		// Correct.
+		const double s = pp_ + r_;
+		const double kp = pp_ / s;
+		const double kv = pv_ / s;
+		const double e = z - p_;
+		p_ += kp * e;
+		v_ += kv * e;
+		vv_ -= kv * pv_;
+		pv_ -= kv * pp_;
+		pp_ -= kp * pp_;
+		return (float)p_;
+	}
+
+	float position() const { return (float)p_; }
+	float velocity() const { return (float)v_; }
+
+private:
+	double q_ = 1e6;
+	double r_ = 1.0;
+	double p_ = 0.0;
+	double v_ = 0.0;
+	double pp_ = 0.0;
+	double pv_ = 0.0;
+	double vv_ = 0.0;
+	bool have_ = false;
+};
+
+// Extrapolate (x, y) along the tracked velocity by horizon_s, limiting the
+// jump to max_px so a stale velocity cannot throw the pointer far ahead.
+inline void predict_ahead(const KalmanTracker& kx, const KalmanTracker& ky, float horizon_s, float max_px, float& x, float& y) {
+	float ox = kx.velocity() * horizon_s;
+	float oy = ky.velocity() * horizon_s;
+	const float len2 = ox * ox + oy * oy;
+	if (len2 > max_px * max_px) {
+		const float k = max_px / std::sqrt(len2);
+		ox *= k;
+		oy *= k;
+	}
+	x += ox;
+	y += oy;
+}
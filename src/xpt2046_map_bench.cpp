@@ -0,0 +1,176 @@
+// Raw-to-screen mapping benchmark: arithmetic path vs. per-axis lookup tables,
+// the affine transform in double precision vs. Q16 fixed point, and the cost
+// of the bilinear mesh correction on top of the tables.
+// Usage: xpt2046_map_bench [samples]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "xpt2046_mapping.h"
+
+static uint32_t xorshift(uint32_t& s) {
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	return s;
+}
+
+// Both paths must agree for every raw value on both axes.
+static int check_equivalence(const MappingParams& p) {
+	ScreenMapper lut;
+	lut.build(p);
+	int mismatches = 0;
+	for (int r = 0; r < 4096; ++r) {
+		int ax = 0, ay = 0, bx = 0, by = 0;
+		map_raw_to_screen(p, r, 4095 - r, ax, ay);
+		lut.map(r, 4095 - r, bx, by);
+		if (ax != bx || ay != by) mismatches++;
+	}
+	return mismatches;
+}
+
+// Fixed point may differ from the double-precision reference by one pixel
+// where the exact value sits on a rounding boundary; anything more is a bug.
+static int check_close(const MappingParams& p, int& off_by_one) {
+	ScreenMapper q16;
+	q16.build(p);
+	int bad = 0;
+	off_by_one = 0;
+	for (int ry = 0; ry < 4096; ry += 7) {
+		for (int rx = 0; rx < 4096; rx += 7) {
+			int ax = 0, ay = 0, bx = 0, by = 0;
+			map_raw_to_screen(p, rx, ry, ax, ay);
+			q16.map(rx, ry, bx, by);
+			const int d = std::max(std::abs(ax - bx), std::abs(ay - by));
+			if (d > 1) bad++;
+			else if (d == 1) off_by_one++;
+		}
+	}
+	return bad;
+}
+
+template <typename MapFn>
+static double time_per_sample(const std::vector<uint16_t>& raw, int samples, int64_t& sink, MapFn fn) {
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < samples; ++i) {
+		int sx = 0, sy = 0;
+		fn(raw[2 * i], raw[2 * i + 1], sx, sy);
+		sink += sx + sy;
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / samples;
+}
+
+int main(int argc, char** argv) {
+	const int samples = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 20000000;
+
+	MappingParams p;
+	p.min_x = 210;
+	p.max_x = 3900;
+	p.min_y = 180;
+	p.max_y = 3850;
+	p.invert_y = 1;
+	p.scale_x = 1.02f;
+	p.scale_y = 0.98f;
+	p.offset_x = -4;
+	p.offset_y = 3;
+	p.deadzone_left = 2;
+	p.deadzone_bottom = 5;
+
+	MappingParams swapped = p;
+	swapped.swap_xy = 1;
+	swapped.invert_x = 1;
+	swapped.screen_w = 480;
+	swapped.screen_h = 320;
+
+	int bad = check_equivalence(p) + check_equivalence(swapped) + check_equivalence(MappingParams());
+	std::printf("equivalence: %s (%d mismatching raw values)\n", bad == 0 ? "ok" : "FAILED", bad);
+
+	// A panel mounted about 1.5 degrees off-axis.
+	MappingParams aff;
+	aff.has_affine = true;
+	const double m[6] = {0.2216, -0.0095, -41.4, 0.0063, 0.1426, -44.0};
+	for (int i = 0; i < 6; ++i) aff.affine[i] = m[i];
+	aff.deadzone_right = 3;
+	int off_by_one = 0;
+	const int bad_aff = check_close(aff, off_by_one);
+	std::printf("affine q16:  %s (%d off by >1 px, %d off by 1 px)\n", bad_aff == 0 ? "ok" : "FAILED", bad_aff, off_by_one);
+	bad += bad_aff;
+
+	// 9x9 mesh pulling the edges inwards like a typical resistive panel.
+	MappingParams meshed = p;
+	meshed.mesh.size = 9;
+	for (int j = 0; j < 9; ++j) {
+		for (int i = 0; i < 9; ++i) {
+			const double u = (i - 4) / 4.0;
+			const double v = (j - 4) / 4.0;
+			meshed.mesh.offsets.push_back((float)(-12.0 * u * u * u + 3.0 * v));
+			meshed.mesh.offsets.push_back((float)(-9.0 * v * v * v - 2.0 * u * v));
+		}
+	}
+	const int bad_mesh = check_close(meshed, off_by_one);
+	std::printf("mesh 9x9:    %s (%d off by >1 px, %d off by 1 px)\n", bad_mesh == 0 ? "ok" : "FAILED", bad_mesh, off_by_one);
+	bad += bad_mesh;
+
+	std::vector<uint16_t> raw((size_t)samples * 2);
+	uint32_t seed = 12345;
+	for (auto& v : raw) v = (uint16_t)(xorshift(seed) & 0xFFF);
+
+	ScreenMapper lut;
+	auto t0 = std::chrono::steady_clock::now();
+	lut.build(p);
+	auto t1 = std::chrono::steady_clock::now();
+
+	int64_t sink = 0;
+	auto t2 = std::chrono::steady_clock::now();
+	for (int i = 0; i < samples; ++i) {
+		int sx = 0, sy = 0;
+		map_raw_to_screen(p, raw[2 * i], raw[2 * i + 1], sx, sy);
+		sink += sx + sy;
+	}
+	auto t3 = std::chrono::steady_clock::now();
+	for (int i = 0; i < samples; ++i) {
+		int sx = 0, sy = 0;
+		lut.map(raw[2 * i], raw[2 * i + 1], sx, sy);
+		sink -= sx + sy;
+	}
+	auto t4 = std::chrono::steady_clock::now();
+
+	auto ns = [](std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+		return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+	};
+	ScreenMapper q16;
+	q16.build(aff);
+	int64_t aff_sink = 0;
+	const double aff_ref = time_per_sample(raw, samples, aff_sink, [&](int x, int y, int& sx, int& sy) {
+		map_raw_to_screen(aff, x, y, sx, sy);
+	});
+	const double aff_q16 = time_per_sample(raw, samples, aff_sink, [&](int x, int y, int& sx, int& sy) {
+		q16.map(x, y, sx, sy);
+	});
+
+	ScreenMapper mesh_lut;
+	auto t5 = std::chrono::steady_clock::now();
+	mesh_lut.build(meshed);
+	auto t6 = std::chrono::steady_clock::now();
+	const double mesh_ref = time_per_sample(raw, samples, aff_sink, [&](int x, int y, int& sx, int& sy) {
+		map_raw_to_screen(meshed, x, y, sx, sy);
+	});
+	const double mesh_fast = time_per_sample(raw, samples, aff_sink, [&](int x, int y, int& sx, int& sy) {
+		mesh_lut.map(x, y, sx, sy);
+	});
+
+	std::printf("table build: %.1f us (with 9x9 mesh: %.1f us)\n", ns(t0, t1) / 1000.0, ns(t5, t6) / 1000.0);
+	std::printf("arithmetic:  %.2f ns/sample\n", ns(t2, t3) / samples);
+	std::printf("lookup:      %.2f ns/sample\n", ns(t3, t4) / samples);
+	std::printf("affine fp64: %.2f ns/sample\n", aff_ref);
+	std::printf("affine q16:  %.2f ns/sample\n", aff_q16);
+	std::printf("mesh fp64:   %.2f ns/sample\n", mesh_ref);
+	std::printf("mesh tables: %.2f ns/sample\n", mesh_fast);
+	std::printf("checksum:    %lld %lld\n", (long long)sink, (long long)aff_sink);
+	return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,279 @@
+#include "xpt2046_mapping.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+template <typename T>
+T clamp_val(T v, T lo, T hi) {
+	return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+// One screen axis from the raw value that feeds it (already swapped).
+int map_axis(int raw, bool invert, int lo, int hi, int screen, float scale, int offset, int dz_lo, int dz_hi) {
+	int v = invert ? 4095 - raw : raw;
+	v = clamp_val(v, lo, hi);
+
+	int s = (v - lo) * (screen - 1) / std::max(1, (hi - lo));
+	s = clamp_val(s, 0, screen - 1);
+	s = (int)std::llround(s * scale + offset);
+
+	int min_s = clamp_val(dz_lo, 0, screen - 1);
+	int max_s = clamp_val(screen - 1 - dz_hi, 0, screen - 1);
+	if (max_s < min_s) max_s = min_s;
+	return clamp_val(s, min_s, max_s);
+}
+
+// Mesh offset at screen (x, y) in double precision: locate the cell holding
+// the point (outer cells extend past the outer nodes) and blend its corners.
+void mesh_offset(const MeshParams& m, int screen_w, int screen_h, double x, double y, double& dx, double& dy) {
+	const int n = m.size;
+	auto locate = [n](double v, int screen, int& cell, double& t) {
+		const double lo = kMeshMargin * (screen - 1);
+		const double step = (1.0 - 2.0 * kMeshMargin) * (screen - 1) / (n - 1);
+		double c = step > 0.0 ? (v - lo) / step : 0.0;
+		cell = clamp_val((int)std::floor(c), 0, n - 2);
+		t = c - cell;
+	};
+	int i = 0, j = 0;
+	double tx = 0.0, ty = 0.0;
+	locate(x, screen_w, i, tx);
+	locate(y, screen_h, j, ty);
+	auto at = [&](int ii, int jj, int k) { return (double)m.offsets[(jj * n + ii) * 2 + k]; };
+	double out[2];
+	for (int k = 0; k < 2; ++k) {
+		const double top = at(i, j, k) * (1.0 - tx) + at(i + 1, j, k) * tx;
+		const double bot = at(i, j + 1, k) * (1.0 - tx) + at(i + 1, j + 1, k) * tx;
+		out[k] = top * (1.0 - ty) + bot * ty;
+	}
+	dx = out[0];
+	dy = out[1];
+}
+
+// Solve the 3x3 system m * x = r by Gaussian elimination with partial pivoting.
+// A pivot counts as zero relative to the matrix's infinity norm, so the test
+// does not depend on the units of the entries (raw values squared here).
+bool solve3(double m[3][3], double r[3], double x[3]) {
+	double norm = 0.0;
+	for (int i = 0; i < 3; ++i) {
+		norm = std::max(norm, std::fabs(m[i][0]) + std::fabs(m[i][1]) + std::fabs(m[i][2]));
+	}
+	const double eps = norm * 1e-10;
+	for (int c = 0; c < 3; ++c) {
+		int piv = c;
+		for (int i = c + 1; i < 3; ++i) {
+			if (std::fabs(m[i][c]) > std::fabs(m[piv][c])) piv = i;
+		}
+		if (!(std::fabs(m[piv][c]) > eps)) return false;
+		if (piv != c) {
+			for (int j = 0; j < 3; ++j) std::swap(m[c][j], m[piv][j]);
+			std::swap(r[c], r[piv]);
+		}
+		for (int i = c + 1; i < 3; ++i) {
+			const double f = m[i][c] / m[c][c];
+			for (int j = c; j < 3; ++j) m[i][j] -= f * m[c][j];
+			r[i] -= f * r[c];
+		}
+	}
+	for (int c = 2; c >= 0; --c) {
+		double v = r[c];
+		for (int j = c + 1; j < 3; ++j) v -= m[c][j] * x[j];
+		x[c] = v / m[c][c];
+	}
+	return true;
+}
+
+} // namespace
+
+void map_raw_to_screen(const MappingParams& p, int raw_x, int raw_y, int& sx, int& sy) {
+	const bool mesh = p.mesh.size > 0;
+	if (p.has_affine) {
+		sx = (int)std::llround(p.affine[0] * raw_x + p.affine[1] * raw_y + p.affine[2]);
+		sy = (int)std::llround(p.affine[3] * raw_x + p.affine[4] * raw_y + p.affine[5]);
+	} else {
+		int x = raw_x;
+		int y = raw_y;
+		if (p.swap_xy) std::swap(x, y);
+		// With a mesh the deadzone clamp moves after the correction.
+		sx = map_axis(x, p.invert_x != 0, p.min_x, p.max_x, p.screen_w, p.scale_x, p.offset_x,
+					  mesh ? 0 : p.deadzone_left, mesh ? 0 : p.deadzone_right);
+		sy = map_axis(y, p.invert_y != 0, p.min_y, p.max_y, p.screen_h, p.scale_y, p.offset_y,
+					  mesh ? 0 : p.deadzone_top, mesh ? 0 : p.deadzone_bottom);
+		if (!mesh) return;
+	}
+	if (mesh) {
+		double dx = 0.0, dy = 0.0;
+		mesh_offset(p.mesh, p.screen_w, p.screen_h, clamp_val(sx, 0, p.screen_w - 1), clamp_val(sy, 0, p.screen_h - 1), dx, dy);
+		sx += (int)std::llround(dx);
+		sy += (int)std::llround(dy);
+	}
+	int lo = 0, hi = 0;
+	deadzone_bounds(p.screen_w, p.deadzone_left, p.deadzone_right, lo, hi);
+	sx = clamp_val(sx, lo, hi);
+	deadzone_bounds(p.screen_h, p.deadzone_top, p.deadzone_bottom, lo, hi);
+	sy = clamp_val(sy, lo, hi);
+}
+
+void ScreenMapper::build(const MappingParams& p) {
+	swap_xy_ = p.swap_xy != 0;
+	invert_x_ = p.invert_x != 0;
+	invert_y_ = p.invert_y != 0;
+	min_ax_ = p.min_x;
+	max_ax_ = p.max_x;
+	min_ay_ = p.min_y;
+	max_ay_ = p.max_y;
+	affine_ = p.has_affine;
+	for (int i = 0; i < 6; ++i) q_[i] = (int64_t)std::llround(p.affine[i] * 65536.0);
+	deadzone_bounds(p.screen_w, p.deadzone_left, p.deadzone_right, min_sx_, max_sx_);
+	deadzone_bounds(p.screen_h, p.deadzone_top, p.deadzone_bottom, min_sy_, max_sy_);
+	mesh_.build(p.mesh, p.screen_w, p.screen_h);
+	if (affine_) return;
+	const bool mesh = mesh_.enabled();
+	for (int r = 0; r < 4096; ++r) {
+		lut_x_[r] = (int16_t)map_axis(r, p.invert_x != 0, p.min_x, p.max_x, p.screen_w, p.scale_x, p.offset_x,
+									  mesh ? 0 : p.deadzone_left, mesh ? 0 : p.deadzone_right);
+		lut_y_[r] = (int16_t)map_axis(r, p.invert_y != 0, p.min_y, p.max_y, p.screen_h, p.scale_y, p.offset_y,
+									  mesh ? 0 : p.deadzone_top, mesh ? 0 : p.deadzone_bottom);
+	}
+}
+
+void MeshTable::build(const MeshParams& m, int screen_w, int screen_h) {
+	size_ = (m.size >= 2 && m.size <= kMaxMeshSize && (int)m.offsets.size() == 2 * m.size * m.size) ? m.size : 0;
+	w_ = std::max(1, screen_w);
+	h_ = std::max(1, screen_h);
+	if (size_ == 0) return;
+
+	auto expand = [this](int screen, std::vector<uint8_t>& cell, std::vector<int16_t>& weight) {
+		cell.assign(screen, 0);
+		weight.assign(screen, 0);
+		const double lo = kMeshMargin * (screen - 1);
+		const double step = (1.0 - 2.0 * kMeshMargin) * (screen - 1) / (size_ - 1);
+		for (int v = 0; v < screen; ++v) {
+			const double c = step > 0.0 ? (v - lo) / step : 0.0;
+			const int i = clamp_val((int)std::floor(c), 0, size_ - 2);
+			cell[v] = (uint8_t)i;
+			weight[v] = (int16_t)std::lround((c - i) * 256.0);
+		}
+	};
+	expand(w_, cx_, wx_);
+	expand(h_, cy_, wy_);
+
+	d_.resize(m.offsets.size());
+	for (size_t k = 0; k < m.offsets.size(); ++k) d_[k] = (int32_t)std::lround(m.offsets[k] * 16.0);
+}
+
+void mesh_node_position(int size, int screen_w, int screen_h, int i, int j, int& x, int& y) {
+	const double fx = kMeshMargin + (1.0 - 2.0 * kMeshMargin) * i / std::max(1, size - 1);
+	const double fy = kMeshMargin + (1.0 - 2.0 * kMeshMargin) * j / std::max(1, size - 1);
+	x = (int)std::lround(fx * (screen_w - 1));
+	y = (int)std::lround(fy * (screen_h - 1));
+}
+
+bool parse_mesh(const std::string& s, MeshParams& out) {
+	size_t colon = s.find(':');
+	if (colon == std::string::npos) return false;
+	const int n = std::atoi(s.substr(0, colon).c_str());
+	if (n < 2 || n > kMaxMeshSize) return false;
+	std::string t = s.substr(colon + 1);
+	std::replace(t.begin(), t.end(), ',', ' ');
+	const char* p = t.c_str();
+	std::vector<float> offs;
+	for (;;) {
+		char* end = nullptr;
+		double v = std::strtod(p, &end);
+		if (end == p) break;
+		if (!std::isfinite(v)) return false;
+		// Keep the fixed-point blend well inside 32 bits.
+		offs.push_back((float)clamp_val(v, -256.0, 256.0));
+		p = end;
+	}
+	while (*p == ' ' || *p == '\t') ++p;
+	if (*p != '\0' || (int)offs.size() != 2 * n * n) return false;
+	out.size = n;
+	out.offsets = offs;
+	return true;
+}
+
+std::string format_mesh(const MeshParams& m) {
+	std::string s = std::to_string(m.size) + ":";
+	char buf[32];
+	for (size_t k = 0; k < m.offsets.size(); ++k) {
+		std::snprintf(buf, sizeof(buf), k ? ",%.1f" : "%.1f", m.offsets[k]);
+		s += buf;
+	}
+	return s;
+}
+
+bool parse_affine(const std::string& s, double out[6]) {
+	std::string t = s;
+	std::replace(t.begin(), t.end(), ',', ' ');
+	const char* p = t.c_str();
+	for (int i = 0; i < 6; ++i) {
+		char* end = nullptr;
+		double v = std::strtod(p, &end);
+		if (end == p || !std::isfinite(v)) return false;
+		out[i] = v;
+		p = end;
+	}
+	while (*p == ' ' || *p == '\t') ++p;
+	return *p == '\0';
+}
+
+std::string format_affine(const double m[6]) {
+	char buf[192];
+	std::snprintf(buf, sizeof(buf), "%.9g,%.9g,%.9g,%.9g,%.9g,%.9g", m[0], m[1], m[2], m[3], m[4], m[5]);
+	return buf;
+}
+
+bool solve_affine(const std::vector<CalPoint>& pts, double out[6], double& rms_px, double& max_px) {
+	if (pts.size() < 3) return false;
+
+	// Normal equations for [x y 1]; same matrix for both outputs. Raw values
+	// are centred first to keep the system well conditioned.
+	double mx = 0.0, my = 0.0;
+	for (const auto& p : pts) {
+		mx += p.raw_x;
+		my += p.raw_y;
+	}
+	mx /= (double)pts.size();
+	my /= (double)pts.size();
+
+	double ata[3][3] = {};
+	double atu[3] = {};
+	double atv[3] = {};
+	for (const auto& p : pts) {
+		const double row[3] = {p.raw_x - mx, p.raw_y - my, 1.0};
+		for (int i = 0; i < 3; ++i) {
+			for (int j = 0; j < 3; ++j) ata[i][j] += row[i] * row[j];
+			atu[i] += row[i] * p.screen_x;
+			atv[i] += row[i] * p.screen_y;
+		}
+	}
+	double m2[3][3];
+	std::copy(&ata[0][0], &ata[0][0] + 9, &m2[0][0]);
+	double cx[3], cy[3];
+	if (!solve3(ata, atu, cx) || !solve3(m2, atv, cy)) return false;
+
+	// Undo the centring: c' = c - a*mx - b*my.
+	out[0] = cx[0];
+	out[1] = cx[1];
+	out[2] = cx[2] - cx[0] * mx - cx[1] * my;
+	out[3] = cy[0];
+	out[4] = cy[1];
+	out[5] = cy[2] - cy[0] * mx - cy[1] * my;
+
+	double sum2 = 0.0;
+	max_px = 0.0;
+	for (const auto& p : pts) {
+		const double ex = out[0] * p.raw_x + out[1] * p.raw_y + out[2] - p.screen_x;
+		const double ey = out[3] * p.raw_x + out[4] * p.raw_y + out[5] - p.screen_y;
+		const double e = std::sqrt(ex * ex + ey * ey);
+		sum2 += e * e;
+		max_px = std::max(max_px, e);
+	}
+	rms_px = std::sqrt(sum2 / (double)pts.size());
+	return true;
+}
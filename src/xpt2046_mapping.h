@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Outer mesh nodes sit this fraction of the screen in from each edge so the
+// capture targets stay touchable; offsets are extrapolated beyond them.
+constexpr double kMeshMargin = 0.04;
+constexpr int kMaxMeshSize = 9;
+
+// Optional non-linear correction applied after the linear/affine mapping: a
+// size x size grid of control points, each holding the pixel offset to add
+// there. Offsets between nodes are interpolated bilinearly.
+struct MeshParams {
+	int size = 0; // 0 = off, else 2..kMaxMeshSize
+	std::vector<float> offsets; // (dx, dy) per node, row-major from top-left
+};
+
+// Screen coordinates left usable by deadzones dz_lo/dz_hi on one axis.
+inline void deadzone_bounds(int screen, int dz_lo, int dz_hi, int& lo, int& hi) {
+	lo = std::min(std::max(dz_lo, 0), screen - 1);
+	hi = std::min(std::max(screen - 1 - dz_hi, 0), screen - 1);
+	if (hi < lo) hi = lo;
+}
+
+// "N:dx,dy,dx,dy,..." with N*N pairs. Returns false on any mismatch.
+bool parse_mesh(const std::string& s, MeshParams& out);
+std::string format_mesh(const MeshParams& m);
+
+// Screen position of node (i = column, j = row).
+void mesh_node_position(int size, int screen_w, int screen_h, int i, int j, int& x, int& y);
+
+// Everything that turns a raw 12-bit sample into a screen coordinate.
+struct MappingParams {
+	int invert_x = 0;
+	int invert_y = 0;
+	int swap_xy = 0;
+	int min_x = 0;
+	int max_x = 4095;
+	int min_y = 0;
+	int max_y = 4095;
+
+	int screen_w = 800;
+	int screen_h = 480;
+	int offset_x = 0;
+	int offset_y = 0;
+	float scale_x = 1.0f;
+	float scale_y = 1.0f;
+
+	int deadzone_left = 0;
+	int deadzone_right = 0;
+	int deadzone_top = 0;
+	int deadzone_bottom = 0;
+
+	// Optional 2x3 affine transform from raw chip coordinates straight to
+	// screen pixels: sx = a*x + b*y + c, sy = d*x + e*y + f. When set it
+	// replaces swap/invert, min/max and scale/offset (it can also express
+	// rotation and skew); deadzones still apply.
+	bool has_affine = false;
+	double affine[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+
+	MeshParams mesh;
+};
+
+// "a,b,c,d,e,f" (commas or spaces). Returns false unless six numbers parse.
+bool parse_affine(const std::string& s, double out[6]);
+std::string format_affine(const double m[6]);
+
+// One calibration target: averaged raw reading and where it was drawn.
+struct CalPoint {
+	double raw_x = 0.0;
+	double raw_y = 0.0;
+	double screen_x = 0.0;
+	double screen_y = 0.0;
+};
+
+// A saved affine fit must hit every target within this many pixels; a worse
+// one means a missed tap or a bad target, not a skewed panel.
+constexpr double kMaxAffineResidualPx = 8.0;
+
+// Least-squares affine fit over N >= 3 non-collinear targets. Fills the RMS
+// and worst-case residual in pixels. Returns false if the points are degenerate.
+bool solve_affine(const std::vector<CalPoint>& pts, double out[6], double& rms_px, double& max_px);
+
+// Straight arithmetic path: swap/invert, clamp to the calibrated range,
+// integer scale to the screen, offset/scale (or the affine transform in
+// double precision), mesh correction, deadzone clamp. This defines the
+// mapping; ScreenMapper below is built from it.
+void map_raw_to_screen(const MappingParams& p, int raw_x, int raw_y, int& sx, int& sy);
+
+// Mesh offsets expanded for the current screen size: per-column and per-row
+// cell index and Q8 weight, plus Q4 node offsets. Applying it is four
+// lookups and a fixed-point bilinear blend per axis.
+class MeshTable {
+public:
+	void build(const MeshParams& m, int screen_w, int screen_h);
+	bool enabled() const { return size_ > 0; }
+
+	void apply(int& sx, int& sy) const {
+		const int x = sx < 0 ? 0 : (sx >= w_ ? w_ - 1 : sx);
+		const int y = sy < 0 ? 0 : (sy >= h_ ? h_ - 1 : sy);
+		const int fx = wx_[x];
+		const int fy = wy_[y];
+		const int32_t* n00 = &d_[(cy_[y] * size_ + cx_[x]) * 2];
+		const int32_t* n01 = n00 + size_ * 2;
+		for (int k = 0; k < 2; ++k) {
+			const int32_t top = n00[k] * (256 - fx) + n00[k + 2] * fx;
+			const int32_t bot = n01[k] * (256 - fx) + n01[k + 2] * fx;
+			const int32_t v = (int32_t)(((int64_t)top * (256 - fy) + (int64_t)bot * fy + (1 << 19)) >> 20);
+			(k == 0 ? sx : sy) += v;
+		}
+	}
+
+private:
+	int size_ = 0;
+	int w_ = 1;
+	int h_ = 1;
+	std::vector<uint8_t> cx_;
+	std::vector<uint8_t> cy_;
+	std::vector<int16_t> wx_;
+	std::vector<int16_t> wy_;
+	std::vector<int32_t> d_;
+};
+
+// Screen X depends only on the (possibly swapped) raw value feeding it, and
+// likewise for Y, so each axis is a 4096-entry table rebuilt whenever the
+// config changes. Per sample that is a select and two loads. An affine
+// calibration mixes both axes and is evaluated in Q16 fixed point instead:
+// four multiply-accumulates and a clamp, no division or rounding calls.
+class ScreenMapper {
+public:
+	ScreenMapper() { build(MappingParams()); }
+
+	void build(const MappingParams& p);
+
+	void map(int raw_x, int raw_y, int& sx, int& sy) const {
+		if (affine_) {
+			const int64_t x = raw_x;
+			const int64_t y = raw_y;
+			sx = (int)((q_[0] * x + q_[1] * y + q_[2] + 0x8000) >> 16);
+			sy = (int)((q_[3] * x + q_[4] * y + q_[5] + 0x8000) >> 16);
+		} else {
+			const int ax = swap_xy_ ? raw_y : raw_x;
+			const int ay = swap_xy_ ? raw_x : raw_y;
+			sx = lut_x_[ax & 0xFFF];
+			sy = lut_y_[ay & 0xFFF];
+			// Plain tables already include the deadzone clamp.
+			if (!mesh_.enabled()) return;
+		}
+		if (mesh_.enabled()) mesh_.apply(sx, sy);
+		sx = sx < min_sx_ ? min_sx_ : (sx > max_sx_ ? max_sx_ : sx);
+		sy = sy < min_sy_ ? min_sy_ : (sy > max_sy_ ? max_sy_ : sy);
+	}
+
+	// The raw sample after swap/invert and the clamp to the calibrated
+	// range: what the linear mapping scales. For the sample feed only.
+	void axes(int raw_x, int raw_y, int& ax, int& ay) const {
+		ax = swap_xy_ ? raw_y : raw_x;
+		ay = swap_xy_ ? raw_x : raw_y;
+		if (invert_x_) ax = 4095 - ax;
+		if (invert_y_) ay = 4095 - ay;
+		ax = ax < min_ax_ ? min_ax_ : (ax > max_ax_ ? max_ax_ : ax);
+		ay = ay < min_ay_ ? min_ay_ : (ay > max_ay_ ? max_ay_ : ay);
+	}
+
+private:
+	bool swap_xy_ = false;
+	bool invert_x_ = false;
+	bool invert_y_ = false;
+	bool affine_ = false;
+	int min_ax_ = 0;
+	int max_ax_ = 4095;
+	int min_ay_ = 0;
+	int max_ay_ = 4095;
+	int64_t q_[6] = {};
+	int min_sx_ = 0;
+	int max_sx_ = 0;
+	int min_sy_ = 0;
+	int max_sy_ = 0;
+	MeshTable mesh_;
+	int16_t lut_x_[4096];
+	int16_t lut_y_[4096];
+};
@@ -0,0 +1,138 @@
+#include "xpt2046_penirq.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+
+class GpioPenIrq : public PenIrqSource {
+public:
+	GpioPenIrq(int line_fd, std::string desc) : fd_(line_fd), desc_(std::move(desc)) {}
+	~GpioPenIrq() override {
+		if (fd_ >= 0) close(fd_);
+	}
+
+	int wait_for_pen_down(int timeout_ms) override {
+		// Edges queued while we were sampling (conversions also toggle PENIRQ)
+		// are stale; drop them and trust the current level instead.
+		drain_events();
+		if (pen_down()) return 1;
+
+		pollfd pfd{fd_, POLLIN, 0};
+		int r = poll(&pfd, 1, timeout_ms);
+		if (r < 0) return -1;
+		if (r == 0) return 0;
+		return drain_events() ? 1 : (pen_down() ? 1 : 0);
+	}
+
+	bool pen_down() override {
+		gpio_v2_line_values vals;
+		std::memset(&vals, 0, sizeof(vals));
+		vals.mask = 1;
+		if (ioctl(fd_, GPIO_V2_LINE_GET_VALUES_IOCTL, &vals) < 0) return false;
+		// Line is active-low: 0 means touched.
+		return (vals.bits & 1) == 0;
+	}
+
+	std::string describe() const override { return desc_; }
+
+private:
+	// Returns true if a falling edge was among the drained events.
+	bool drain_events() {
+		bool falling = false;
+		gpio_v2_line_event evs[8];
+		for (;;) {
+			pollfd pfd{fd_, POLLIN, 0};
+			if (poll(&pfd, 1, 0) <= 0) break;
+			ssize_t n = read(fd_, evs, sizeof(evs));
+			if (n <= 0) break;
+			for (ssize_t i = 0; i < n / (ssize_t)sizeof(evs[0]); ++i) {
+				if (evs[i].id == GPIO_V2_LINE_EVENT_FALLING_EDGE) falling = true;
+			}
+		}
+		return falling;
+	}
+
+	int fd_;
+	std::string desc_;
+};
+
+} // namespace
+
+IdleWait choose_idle_wait(bool contact, PenIrqSource* penirq) {
+	if (contact) return IdleWait::Active;
+	if (!penirq || penirq->pen_down()) return IdleWait::Poll;
+	return IdleWait::PenIrq;
+}
+
+std::unique_ptr<PenIrqSource> open_gpio_penirq(const std::string& chip_path, int line, std::string& err) {
+	if (line < 0) {
+		err = "no line configured";
+		return nullptr;
+	}
+	int chip_fd = open(chip_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (chip_fd < 0) {
+		err = std::string("open(") + chip_path + "): " + std::strerror(errno);
+		return nullptr;
+	}
+
+	gpio_v2_line_request req;
+	std::memset(&req, 0, sizeof(req));
+	req.offsets[0] = (uint32_t)line;
+	req.num_lines = 1;
+	std::snprintf(req.consumer, sizeof(req.consumer), "xpt2046_penirq");
+	req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_FALLING | GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+	int ret = ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req);
+	int saved_errno = errno;
+	close(chip_fd);
+	if (ret < 0 || req.fd < 0) {
+		err = std::string("GPIO_V2_GET_LINE_IOCTL: ") + std::strerror(saved_errno);
+		return nullptr;
+	}
+	return std::unique_ptr<PenIrqSource>(new GpioPenIrq(req.fd, chip_path + ":" + std::to_string(line)));
+}
+
+FakePenIrq::FakePenIrq() {
+	efd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+FakePenIrq::~FakePenIrq() {
+	if (efd_ >= 0) close(efd_);
+}
+
+void FakePenIrq::inject(bool down) {
+	bool was = down_.exchange(down);
+	if (down && !was && efd_ >= 0) {
+		uint64_t one = 1;
+		(void)write(efd_, &one, sizeof(one));
+	}
+}
+
+int FakePenIrq::wait_for_pen_down(int timeout_ms) {
+	uint64_t cnt = 0;
+	(void)read(efd_, &cnt, sizeof(cnt));
+	if (down_) return 1;
+
+	pollfd pfd{efd_, POLLIN, 0};
+	int r = poll(&pfd, 1, timeout_ms);
+	if (r < 0) return -1;
+	if (r == 0) return 0;
+	(void)read(efd_, &cnt, sizeof(cnt));
+	return 1;
+}
+
+bool FakePenIrq::pen_down() {
+	return down_;
+}
+
+std::string FakePenIrq::describe() const {
+	return "fake";
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Pen-interrupt (PENIRQ) source. The XPT2046 pulls PENIRQ low while the panel
+// is touched (as long as the last command left PD1:PD0 = 00), so the daemon can
+// block here while idle instead of polling SPI every poll_us.
+class PenIrqSource {
+public:
+	virtual ~PenIrqSource() = default;
+
+	// Block until the pen goes down or timeout_ms elapses (-1 = forever).
+	// Returns 1 when the pen is down, 0 on timeout, -1 on error/signal.
+	// Returns 1 at once while the line is already low; see choose_idle_wait().
+	virtual int wait_for_pen_down(int timeout_ms) = 0;
+
+	// Current line level (true while the panel is touched).
+	virtual bool pen_down() = 0;
+
+	// Human-readable description for logs.
+	virtual std::string describe() const = 0;
+};
+
+// How the acquisition thread waits before its next sample.
+enum class IdleWait {
+	Active, // touch in progress: fast cadence
+	Poll,   // poll_us timer
+	PenIrq, // block in wait_for_pen_down()
+};
+
+// contact = the last sample pressed or continues a touch. PENIRQ replaces
+// polling only while the line is high: a touch too light for press_threshold,
+// or one the confirmation burst rejected, keeps it low, and blocking on it
+// would return at once on every pass.
+IdleWait choose_idle_wait(bool contact, PenIrqSource* penirq);
+
+// Real backend: Linux GPIO character device, uAPI v2 line events.
+// Returns nullptr (and fills err) if the line cannot be requested.
+std::unique_ptr<PenIrqSource> open_gpio_penirq(const std::string& chip_path, int line, std::string& err);
+
+// Fake backend for tests and simulation: edges are injected by the caller and
+// delivered through an eventfd, so wait_for_pen_down() blocks like the real one.
+class FakePenIrq : public PenIrqSource {
+public:
+	FakePenIrq();
+	~FakePenIrq() override;
+
+	// Set the line level. A transition to "down" is reported as a falling edge.
+	void inject(bool down);
+
+	int wait_for_pen_down(int timeout_ms) override;
+	bool pen_down() override;
+	std::string describe() const override;
+
+private:
+	int efd_ = -1;
+	std::atomic<bool> down_{false};
+};
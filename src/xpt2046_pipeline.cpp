@@ -0,0 +1,35 @@
+#include "xpt2046_pipeline.h"
+
+namespace {
+
+// Generic chain: every stage present, each behind its runtime flag.
+using GenericChain = Pipeline<Optional<DeltaClampStage>,
+							  Optional<MedianStage<0>>,
+							  Optional<IirStage>,
+							  Optional<OneEuroStage>,
+							  Optional<KalmanStage>>;
+
+template <typename Chain>
+bool try_make(const FilterParams& p, const char* name, std::unique_ptr<FilterChain>& out) {
+	if (out || !Chain::matches(p)) return false;
+	out.reset(new Chain(p, name));
+	return true;
+}
+
+} // namespace
+
+std::unique_ptr<FilterChain> make_filter_chain(const FilterParams& p) {
+	std::unique_ptr<FilterChain> c;
+	// The shipped default first, then the configurations the README suggests.
+	try_make<Pipeline<MedianStage<3>, IirStage>>(p, "median3+iir", c);
+	try_make<Pipeline<MedianStage<5>, IirStage>>(p, "median5+iir", c);
+	try_make<Pipeline<IirStage>>(p, "iir", c);
+	try_make<Pipeline<MedianStage<3>>>(p, "median3", c);
+	try_make<Pipeline<MedianStage<3>, OneEuroStage>>(p, "median3+one_euro", c);
+	try_make<Pipeline<OneEuroStage>>(p, "one_euro", c);
+	try_make<Pipeline<MedianStage<3>, KalmanStage>>(p, "median3+kalman", c);
+	try_make<Pipeline<DeltaClampStage, MedianStage<3>, IirStage>>(p, "clamp+median3+iir", c);
+	try_make<Pipeline<>>(p, "passthrough", c);
+	if (!c) c.reset(new GenericChain(p, "generic"));
+	return c;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+
+#include "xpt2046_filters.h"
+#include "xpt2046_mapping.h"
+
+// Filter settings shared by the daemon and the calibrator.
+struct FilterParams {
+	int screen_w = 800;
+	int screen_h = 480;
+	// Same deadzones as the mapping; stages that extrapolate stay inside them.
+	int deadzone_left = 0;
+	int deadzone_right = 0;
+	int deadzone_top = 0;
+	int deadzone_bottom = 0;
+	int max_delta_px = 0;
+	int median_window = 3;
+	float iir_alpha = 0.20f;
+	float euro_min_cutoff = 0.0f;
+	float euro_beta = 0.01f;
+	float euro_d_cutoff = 1.0f;
+	float kalman_noise_px = 0.0f;
+	float kalman_accel = 30000.0f;
+	int predict_ms = 0;
+	int predict_max_px = 24;
+};
+
+// One mapped sample travelling through the chain. Stages rewrite x/y.
+struct FilterSample {
+	int x = 0;
+	int y = 0;
+	int64_t t_ns = 0;
+	bool pressed = true; // pressure above press_threshold (not lifting)
+
+	// Previous output before prediction; max_delta_px limits against it.
+	bool have_ref = false;
+	int ref_x = 0;
+	int ref_y = 0;
+
+	// Set by a predicting stage to the position before extrapolation.
+	bool predicted = false;
+	int settled_x = 0;
+	int settled_y = 0;
+};
+
+// Stages. Each is a policy type with configure/reset/apply and a static
+// enabled() telling whether a configuration needs it.
+
+struct DeltaClampStage {
+	static bool enabled(const FilterParams& p) { return p.max_delta_px > 0; }
+	void configure(const FilterParams& p) { max_ = p.max_delta_px; }
+	void reset() {}
+	void apply(FilterSample& s) {
+		if (!s.have_ref) return;
+		s.x = std::min(std::max(s.x, s.ref_x - max_), s.ref_x + max_);
+		s.y = std::min(std::max(s.y, s.ref_y - max_), s.ref_y + max_);
+	}
+	int max_ = 0;
+};
+
+// W > 0: window fixed at compile time (selection network inlined).
+// W == 0: window taken from the config.
+template <int W>
+struct MedianStage {
+	static bool enabled(const FilterParams& p) { return W > 0 ? p.median_window == W : p.median_window > 0; }
+	void configure(const FilterParams& p) { window_ = W > 0 ? W : p.median_window; }
+	void reset() {
+		hx_.clear();
+		hy_.clear();
+	}
+	void apply(FilterSample& s) {
+		hx_.push(s.x);
+		hy_.push(s.y);
+		if constexpr (W > 0) {
+			if (hx_.size() == (size_t)W) {
+				s.x = hx_.template median_full<W>();
+				s.y = hy_.template median_full<W>();
+				return;
+			}
+		}
+		s.x = hx_.median(window_);
+		s.y = hy_.median(window_);
+	}
+	int window_ = W;
+	MedianWindow<(W > 0 ? W : kMaxMedianWindow)> hx_;
+	MedianWindow<(W > 0 ? W : kMaxMedianWindow)> hy_;
+};
+
+struct IirStage {
+	static bool enabled(const FilterParams& p) { return p.euro_min_cutoff <= 0.0f && p.iir_alpha > 0.0f; }
+	void configure(const FilterParams& p) { a_ = p.iir_alpha; }
+	void reset() { have_ = false; }
+	void apply(FilterSample& s) {
+		if (have_) {
+			s.x = (int)std::llround((1.0f - a_) * (float)x_ + a_ * (float)s.x);
+			s.y = (int)std::llround((1.0f - a_) * (float)y_ + a_ * (float)s.y);
+		}
+		x_ = s.x;
+		y_ = s.y;
+		have_ = true;
+	}
+	float a_ = 0.2f;
+	int x_ = 0;
+	int y_ = 0;
+	bool have_ = false;
+};
+
+struct OneEuroStage {
+	static bool enabled(const FilterParams& p) { return p.euro_min_cutoff > 0.0f; }
+	void configure(const FilterParams& p) {
+		fx_.configure(p.euro_min_cutoff, p.euro_beta, p.euro_d_cutoff);
+		fy_.configure(p.euro_min_cutoff, p.euro_beta, p.euro_d_cutoff);
+	}
+	void reset() {
+		fx_.reset();
+		fy_.reset();
+	}
+	void apply(FilterSample& s) {
+		const float dt = (float)(s.t_ns - t_ns_) * 1e-9f;
+		t_ns_ = s.t_ns;
+		s.x = (int)std::lround(fx_.filter((float)s.x, dt));
+		s.y = (int)std::lround(fy_.filter((float)s.y, dt));
+	}
+	OneEuroFilter fx_;
+	OneEuroFilter fy_;
+	int64_t t_ns_ = 0;
+};
+
+struct KalmanStage {
+	static bool enabled(const FilterParams& p) { return p.kalman_noise_px > 0.0f; }
+	void configure(const FilterParams& p) {
+		kx_.configure(p.kalman_accel, p.kalman_noise_px);
+		ky_.configure(p.kalman_accel, p.kalman_noise_px);
+		horizon_s_ = p.predict_ms * 1e-3f;
+		max_px_ = (float)p.predict_max_px;
+		deadzone_bounds(p.screen_w, p.deadzone_left, p.deadzone_right, min_x_, max_x_);
+		deadzone_bounds(p.screen_h, p.deadzone_top, p.deadzone_bottom, min_y_, max_y_);
+	}
+	void reset() {
+		kx_.reset();
+		ky_.reset();
+	}
+	void apply(FilterSample& s) {
+		const float dt = (float)(s.t_ns - t_ns_) * 1e-9f;
+		t_ns_ = s.t_ns;
+		float px = kx_.update((float)s.x, dt);
+		float py = ky_.update((float)s.y, dt);
+		s.settled_x = (int)std::lround(px);
+		s.settled_y = (int)std::lround(py);
+		s.predicted = true;
+		// Lifting the finger lowers the pressure first: stop extrapolating
+		// then so the pointer does not overshoot where the stroke ended.
+		if (horizon_s_ > 0.0f && s.pressed) predict_ahead(kx_, ky_, horizon_s_, max_px_, px, py);
+		// Prediction (and the tracker itself) can overshoot past the last
+		// sample; keep the result where the mapper could have put it.
+		s.x = std::min(std::max((int)std::lround(px), min_x_), max_x_);
+		s.y = std::min(std::max((int)std::lround(py), min_y_), max_y_);
+		s.settled_x = std::min(std::max(s.settled_x, min_x_), max_x_);
+		s.settled_y = std::min(std::max(s.settled_y, min_y_), max_y_);
+	}
+	KalmanTracker kx_;
+	KalmanTracker ky_;
+	int64_t t_ns_ = 0;
+	float horizon_s_ = 0.0f;
+	float max_px_ = 24.0f;
+	int min_x_ = 0;
+	int max_x_ = 799;
+	int min_y_ = 0;
+	int max_y_ = 479;
+};
+
+// Wraps a stage behind a runtime flag; used only by the generic fallback.
+template <typename S>
+struct Optional {
+	static bool enabled(const FilterParams&) { return true; }
+	void configure(const FilterParams& p) {
+		on_ = S::enabled(p);
+		s_.configure(p);
+	}
+	void reset() { s_.reset(); }
+	void apply(FilterSample& s) {
+		if (on_) s_.apply(s);
+	}
+	S s_;
+	bool on_ = false;
+};
+
+// What the daemon and calibrator hold: one virtual call per sample into a
+// chain picked when the config is loaded.
+class FilterChain {
+public:
+	virtual ~FilterChain() = default;
+	virtual void reset() = 0;
+	virtual void process(FilterSample& s) = 0;
+	virtual const char* name() const = 0;
+	// New coefficients, state kept. Only valid for p that make_filter_chain()
+	// maps to a chain of the same name.
+	virtual void reconfigure(const FilterParams& p) = 0;
+};
+
+// Stages run in the listed order with no per-stage branches; a stage that
+// is not listed costs nothing.
+template <typename... Stages>
+class Pipeline final : public FilterChain {
+public:
+	Pipeline(const FilterParams& p, const char* name) : name_(name) {
+		std::apply([&](auto&... st) { (st.configure(p), ...); }, stages_);
+	}
+
+	// True if this chain computes exactly what p asks for.
+	static bool matches(const FilterParams& p) {
+		return (Stages::enabled(p) && ...) && (count_enabled(p) == sizeof...(Stages));
+	}
+
+	void reset() override {
+		std::apply([](auto&... st) { (st.reset(), ...); }, stages_);
+		have_ref_ = false;
+	}
+
+	void process(FilterSample& s) override {
+		s.have_ref = have_ref_;
+		s.ref_x = ref_x_;
+		s.ref_y = ref_y_;
+		s.predicted = false;
+		std::apply([&](auto&... st) { (st.apply(s), ...); }, stages_);
+		if (!s.predicted) {
+			s.settled_x = s.x;
+			s.settled_y = s.y;
+		}
+		ref_x_ = s.settled_x;
+		ref_y_ = s.settled_y;
+		have_ref_ = true;
+	}
+
+	const char* name() const override { return name_; }
+
+	void reconfigure(const FilterParams& p) override {
+		std::apply([&](auto&... st) { (st.configure(p), ...); }, stages_);
+	}
+
+private:
+	static int count_enabled(const FilterParams& p) {
+		return (int)DeltaClampStage::enabled(p) + (int)MedianStage<0>::enabled(p) + (int)IirStage::enabled(p) +
+			   (int)OneEuroStage::enabled(p) + (int)KalmanStage::enabled(p);
+	}
+
+	std::tuple<Stages...> stages_;
+	const char* name_;
+	bool have_ref_ = false;
+	int ref_x_ = 0;
+	int ref_y_ = 0;
+};
+
+// Picks a specialized chain for the common configurations and falls back
+// to a generic one that tests each stage's flag per sample.
+std::unique_ptr<FilterChain> make_filter_chain(const FilterParams& p);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer ring. N must be a power of two.
+// The producer never blocks: when the ring is full the new item is dropped
+// and counted as an overrun, so sampling cadence never depends on the consumer.
+template <typename T, size_t N>
+class SpscRing {
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+	// Producer side.
+	bool push(const T& item) {
+		const size_t head = head_.load(std::memory_order_relaxed);
+		const size_t tail = tail_.load(std::memory_order_acquire);
+		if (head - tail >= N) {
+			overruns_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		buf_[head & (N - 1)] = item;
+		head_.store(head + 1, std::memory_order_release);
+
+		const size_t occ = head + 1 - tail;
+		if (occ > high_water_.load(std::memory_order_relaxed)) high_water_.store(occ, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Consumer side.
+	bool pop(T& out) {
+		const size_t tail = tail_.load(std::memory_order_relaxed);
+		const size_t head = head_.load(std::memory_order_acquire);
+		if (tail == head) return false;
+		out = buf_[tail & (N - 1)];
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Monitoring (safe from any thread; values are snapshots).
+	size_t occupancy() const {
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+	size_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+	uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+	uint64_t pushed() const { return head_.load(std::memory_order_relaxed); }
+	static constexpr size_t capacity() { return N; }
+
+private:
+	// Producer and consumer indices on separate cache lines.
+	alignas(64) std::atomic<size_t> head_{0};
+	alignas(64) std::atomic<size_t> tail_{0};
+	alignas(64) std::atomic<size_t> high_water_{0};
+	std::atomic<uint64_t> overruns_{0};
+	T buf_[N];
+};
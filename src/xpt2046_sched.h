@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <time.h>
+
+inline int64_t monotonic_ns() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Wakeup lateness (actual wakeup - deadline) collected by the sampling thread.
+// Written by one thread, read as snapshots from any other; p99 comes from a
+// fixed 10 us histogram, so recording never allocates.
+class SchedStats {
+public:
+	static constexpr int kBucketUs = 10;
+	static constexpr int kBuckets = 512; // last bucket collects everything >= 5.11 ms
+
+	void record(int64_t late_ns) {
+		if (late_ns < 0) late_ns = 0;
+		const int64_t late_us = late_ns / 1000;
+		const uint64_t n = count_.load(std::memory_order_relaxed);
+		if (n == 0 || late_us < min_us_.load(std::memory_order_relaxed)) min_us_.store(late_us, std::memory_order_relaxed);
+		if (late_us > max_us_.load(std::memory_order_relaxed)) max_us_.store(late_us, std::memory_order_relaxed);
+		sum_us_.fetch_add(late_us, std::memory_order_relaxed);
+		int b = (int)(late_us / kBucketUs);
+		if (b >= kBuckets) b = kBuckets - 1;
+		hist_[b].fetch_add(1, std::memory_order_relaxed);
+		const int64_t miss = miss_us_.load(std::memory_order_relaxed);
+		if (miss > 0 && late_us > miss) missed_.fetch_add(1, std::memory_order_relaxed);
+		count_.store(n + 1, std::memory_order_release);
+	}
+
+	// Deadline-miss mode: wakeups later than this (and skipped periods) are
+	// counted as misses. 0 disables it.
+	void set_miss_threshold_us(int64_t us) { miss_us_.store(us, std::memory_order_relaxed); }
+	int64_t miss_threshold_us() const { return miss_us_.load(std::memory_order_relaxed); }
+	uint64_t missed() const { return missed_.load(std::memory_order_relaxed); }
+
+	// Periods dropped because the loop fell more than one period behind.
+	void add_skipped(uint64_t n) {
+		skipped_.fetch_add(n, std::memory_order_relaxed);
+		if (miss_us_.load(std::memory_order_relaxed) > 0) missed_.fetch_add(n, std::memory_order_relaxed);
+	}
+
+	uint64_t count() const { return count_.load(std::memory_order_acquire); }
+	uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+	int64_t min_us() const { return count() ? min_us_.load(std::memory_order_relaxed) : 0; }
+	int64_t max_us() const { return max_us_.load(std::memory_order_relaxed); }
+	double mean_us() const {
+		const uint64_t n = count();
+		return n ? (double)sum_us_.load(std::memory_order_relaxed) / (double)n : 0.0;
+	}
+
+	// Upper edge of the histogram bucket holding the 99th percentile.
+	int64_t p99_us() const {
+		uint64_t total = 0;
+		for (int i = 0; i < kBuckets; ++i) total += hist_[i].load(std::memory_order_relaxed);
+		if (total == 0) return 0;
+		const uint64_t target = total - total / 100;
+		uint64_t acc = 0;
+		for (int i = 0; i < kBuckets; ++i) {
+			acc += hist_[i].load(std::memory_order_relaxed);
+			if (acc >= target) return (int64_t)(i + 1) * kBucketUs;
+		}
+		return (int64_t)kBuckets * kBucketUs;
+	}
+
+private:
+	std::atomic<uint64_t> count_{0};
+	std::atomic<uint64_t> skipped_{0};
+	std::atomic<int64_t> min_us_{0};
+	std::atomic<int64_t> max_us_{0};
+	std::atomic<int64_t> sum_us_{0};
+	std::atomic<int64_t> miss_us_{0};
+	std::atomic<uint64_t> missed_{0};
+	std::atomic<uint32_t> hist_[kBuckets] = {};
+};
+
+// Absolute-deadline pacing on CLOCK_MONOTONIC. Deadlines advance by exactly one
+// period from the previous deadline (not from when the work finished), so the
+// sample rate does not drift with the amount of work done per sample. If the
+// loop falls more than a whole period behind, the missed slots are skipped
+// instead of being run back to back.
+class DeadlineTimer {
+public:
+	// Start a new phase at now_ns; the next deadline is one period later.
+	void rearm(int64_t now_ns) { next_ns_ = now_ns; }
+
+	// Sleep until the next deadline and record how late we woke up.
+	void wait_next(int64_t period_ns, SchedStats& stats) {
+		if (period_ns <= 0) period_ns = 1;
+		next_ns_ += period_ns;
+		int64_t now = monotonic_ns();
+		if (now - next_ns_ >= period_ns) {
+			const int64_t behind = (now - next_ns_) / period_ns;
+			next_ns_ += behind * period_ns;
+			stats.add_skipped((uint64_t)behind);
+		}
+
+		timespec ts;
+		ts.tv_sec = (time_t)(next_ns_ / 1000000000LL);
+		ts.tv_nsec = (long)(next_ns_ % 1000000000LL);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+		}
+		stats.record(monotonic_ns() - next_ns_);
+	}
+
+private:
+	int64_t next_ns_ = 0;
+};
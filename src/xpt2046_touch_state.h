@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+
+// Touch lifecycle of the uinput daemon, fed one sample at a time:
+//
+//   Idle -> Confirming -> Down -> Releasing -> Idle
+//
+// A sample at or above the press level starts a contact. It goes Down on a
+// second hit, or at once when the acquisition thread already voted on a
+// confirmation burst. A sample at or below the release level, or one that
+// could not be read, moves Down to Releasing. The release is reported on
+// the next such sample, or when release_max has passed since the first one,
+// whichever comes first, so touch-up latency has a hard bound. If no valid
+// contact sample arrives for release_timeout while down (stalled or failing
+// reads), tick() releases the contact as well.
+enum class TouchState : uint8_t { Idle, Confirming, Down, Releasing };
+enum class TouchEvent : uint8_t { None, Press, Release };
+
+class TouchStateMachine {
+public:
+	// press_threshold <= 0 falls back to "any pressure" / "no pressure".
+	void configure(int press_threshold, int release_threshold, int release_max_ms, int release_timeout_ms) {
+		press_level_ = press_threshold > 0 ? press_threshold : 1;
+		release_level_ = press_threshold > 0 ? release_threshold : 0;
+		release_max_ns_ = (int64_t)release_max_ms * 1000000LL;
+		release_timeout_ns_ = (int64_t)release_timeout_ms * 1000000LL;
+	}
+
+	// valid = the reading produced a position. confirm is the burst vote of
+	// the acquisition thread: -1 = none, 0 = rejected, 1 = confirmed.
+	TouchEvent update(int64_t t_ns, bool valid, int pressure, int confirm = -1) {
+		const bool hit = valid && pressure >= press_level_;
+		const bool low = !valid || pressure <= release_level_;
+		switch (state_) {
+		case TouchState::Idle:
+			if (!hit) return TouchEvent::None;
+			if (confirm >= 0) {
+				if (confirm == 0) {
+					rejected_++;
+					return TouchEvent::None;
+				}
+				confirmed_++;
+				return press(t_ns);
+			}
+			state_ = TouchState::Confirming;
+			return TouchEvent::None;
+		case TouchState::Confirming:
+			if (hit) return press(t_ns);
+			state_ = TouchState::Idle;
+			return TouchEvent::None;
+		case TouchState::Down:
+			if (!low) {
+				last_contact_ns_ = t_ns;
+				return TouchEvent::None;
+			}
+			state_ = TouchState::Releasing;
+			release_start_ns_ = t_ns;
+			return TouchEvent::None;
+		case TouchState::Releasing:
+			if (!low) {
+				// Pressure dipped for one sample only.
+				state_ = TouchState::Down;
+				last_contact_ns_ = t_ns;
+				return TouchEvent::None;
+			}
+			return release();
+		}
+		return TouchEvent::None;
+	}
+
+	// Time-driven part: releases a contact whose samples stopped or failed.
+	TouchEvent tick(int64_t now_ns) {
+		if (state_ == TouchState::Releasing && now_ns - release_start_ns_ >= release_max_ns_) {
+			bounded_releases_++;
+			return release();
+		}
+		if (down() && now_ns - last_contact_ns_ >= release_timeout_ns_) {
+			timeout_releases_++;
+			return release();
+		}
+		return TouchEvent::None;
+	}
+
+	// CLOCK_MONOTONIC time tick() must run by, or -1 while no contact is open.
+	int64_t next_deadline_ns() const {
+		if (!down()) return -1;
+		int64_t deadline = last_contact_ns_ + release_timeout_ns_;
+		if (state_ == TouchState::Releasing && release_start_ns_ + release_max_ns_ < deadline) {
+			deadline = release_start_ns_ + release_max_ns_;
+		}
+		return deadline;
+	}
+
+	// Drop an open contact without reporting it (device recreated, reset).
+	void reset() { state_ = TouchState::Idle; }
+
+	TouchState state() const { return state_; }
+	// A contact is open (reported pressed and not yet released).
+	bool down() const { return state_ == TouchState::Down || state_ == TouchState::Releasing; }
+
+	uint64_t confirmed() const { return confirmed_; }
+	uint64_t rejected() const { return rejected_; }
+	uint64_t bounded_releases() const { return bounded_releases_; }
+	uint64_t timeout_releases() const { return timeout_releases_; }
+
+private:
+	TouchEvent press(int64_t t_ns) {
+		state_ = TouchState::Down;
+		last_contact_ns_ = t_ns;
+		return TouchEvent::Press;
+	}
+
+	TouchEvent release() {
+		state_ = TouchState::Idle;
+		return TouchEvent::Release;
+	}
+
+	TouchState state_ = TouchState::Idle;
+	int press_level_ = 1;
+	int release_level_ = 0;
+	int64_t release_max_ns_ = 15000000;
+	int64_t release_timeout_ns_ = 100000000;
+	int64_t last_contact_ns_ = 0;
+	int64_t release_start_ns_ = 0;
+	uint64_t confirmed_ = 0;
+	uint64_t rejected_ = 0;
+	uint64_t bounded_releases_ = 0;
+	uint64_t timeout_releases_ = 0;
+};
@@ -0,0 +1,380 @@
+// Tracking benchmark: lag vs. overshoot of the smoothing and prediction
+// stages on recorded or synthetic strokes.
+// Usage: xpt2046_track_bench [--latency_ms N] [--screen WxH] [--press N]
+//                            [--kalman_accel A] [--predict_max_px N] [trace ...]
+//
+// Traces are calibrator recordings (--record, "t_us x y z1 z2" per line),
+// mapped with the default 0..4095 ranges. Without traces a set of synthetic
+// drags (minimum-jerk moves with 1.5 px noise that rest before lifting) is
+// used. Lag is the distance between the emitted position and where the
+// finger is latency_ms later (what the user sees once the compositor has
+// caught up); for recorded traces a centred 5-sample mean stands in for the
+// true position. Overshoot is how far past the final resting point, along
+// the direction of travel, the output goes near the end of a stroke.
+//
+// It also runs each specialized filter chain against the generic fallback
+// on the same samples: outputs must match, and the time shows what the
+// runtime stage flags cost.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "xpt2046_filters.h"
+#include "xpt2046_mapping.h"
+#include "xpt2046_pipeline.h"
+
+struct Sample {
+	int64_t t_us = 0;
+	float x = 0.0f; // measured, screen px
+	float y = 0.0f;
+	float tx = 0.0f; // reference position
+	float ty = 0.0f;
+	bool pressed = true; // pressure above press_threshold (false while lifting)
+};
+
+using Stroke = std::vector<Sample>;
+
+static uint32_t xorshift(uint32_t& s) {
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	return s;
+}
+
+static float gauss(uint32_t& s) {
+	const float u1 = ((xorshift(s) >> 8) + 1) * (1.0f / 16777217.0f);
+	const float u2 = (xorshift(s) >> 8) * (1.0f / 16777216.0f);
+	return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+}
+
+static std::vector<Stroke> synthetic_strokes(int screen_w, int screen_h) {
+	std::vector<Stroke> strokes;
+	uint32_t seed = 2024;
+	for (int n = 0; n < 60; ++n) {
+		const float x0 = 40.0f + (xorshift(seed) % (screen_w - 80));
+		const float y0 = 40.0f + (xorshift(seed) % (screen_h - 80));
+		const float x1 = 40.0f + (xorshift(seed) % (screen_w - 80));
+		const float y1 = 40.0f + (xorshift(seed) % (screen_h - 80));
+		const int move_ms = 120 + (int)(xorshift(seed) % 400);
+		const int rest_ms = 60;
+		Stroke s;
+		for (int t = 0; t <= rest_ms + move_ms + rest_ms; t += 5) {
+			float u = (float)(t - rest_ms) / move_ms;
+			u = std::max(0.0f, std::min(1.0f, u));
+			const float k = u * u * u * (10.0f - 15.0f * u + 6.0f * u * u); // minimum jerk
+			Sample p;
+			p.t_us = (int64_t)t * 1000;
+			p.tx = x0 + (x1 - x0) * k;
+			p.ty = y0 + (y1 - y0) * k;
+			p.x = p.tx + 1.5f * gauss(seed);
+			p.y = p.ty + 1.5f * gauss(seed);
+			s.push_back(p);
+		}
+		// Pressure falls below press_threshold for the last two samples.
+		s[s.size() - 1].pressed = false;
+		s[s.size() - 2].pressed = false;
+		strokes.push_back(s);
+	}
+	return strokes;
+}
+
+static bool load_trace(const std::string& path, int screen_w, int screen_h, int press, std::vector<Stroke>& strokes) {
+	std::ifstream in(path);
+	if (!in.good()) return false;
+	MappingParams mp;
+	mp.screen_w = screen_w;
+	mp.screen_h = screen_h;
+	ScreenMapper mapper;
+	mapper.build(mp);
+	const int release = press * 2 / 3;
+
+	Stroke cur;
+	bool down = false;
+	std::string line;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream ls(line);
+		long long t = 0;
+		int x = 0, y = 0, z1 = 0, z2 = 0;
+		if (!(ls >> t >> x >> y >> z1 >> z2)) continue;
+		if (!down) down = z1 >= press;
+		else if (z1 <= release) down = false;
+		if (!down) {
+			if (cur.size() >= 10) strokes.push_back(cur);
+			cur.clear();
+			continue;
+		}
+		int sx = 0, sy = 0;
+		mapper.map(x, y, sx, sy);
+		Sample p;
+		p.t_us = t;
+		p.x = (float)sx;
+		p.y = (float)sy;
+		p.pressed = z1 >= press;
+		cur.push_back(p);
+	}
+	if (cur.size() >= 10) strokes.push_back(cur);
+
+	for (auto& s : strokes) {
+		for (size_t i = 0; i < s.size(); ++i) {
+			const size_t a = i >= 2 ? i - 2 : 0;
+			const size_t b = std::min(s.size() - 1, i + 2);
+			float sx = 0.0f, sy = 0.0f;
+			for (size_t j = a; j <= b; ++j) {
+				sx += s[j].x;
+				sy += s[j].y;
+			}
+			s[i].tx = sx / (b - a + 1);
+			s[i].ty = sy / (b - a + 1);
+		}
+	}
+	return true;
+}
+
+// Reference position at time t_us, linearly interpolated and held at the
+// stroke end.
+static void reference_at(const Stroke& s, int64_t t_us, float& x, float& y) {
+	size_t i = 0;
+	while (i + 1 < s.size() && s[i + 1].t_us <= t_us) i++;
+	if (i + 1 >= s.size() || t_us <= s[i].t_us) {
+		x = s[i].tx;
+		y = s[i].ty;
+		return;
+	}
+	const float u = (float)(t_us - s[i].t_us) / (float)(s[i + 1].t_us - s[i].t_us);
+	x = s[i].tx + (s[i + 1].tx - s[i].tx) * u;
+	y = s[i].ty + (s[i + 1].ty - s[i].ty) * u;
+}
+
+struct Stage {
+	const char* name;
+	float iir_alpha; // < 0: not used
+	float euro_min_cutoff; // 0: not used
+	float euro_beta;
+	float kalman_noise_px; // 0: not used
+	int predict_ms;
+};
+
+struct Result {
+	double lag_px = 0.0;
+	double jitter_px = 0.0;
+	double overshoot_mean_px = 0.0;
+	double overshoot_max_px = 0.0;
+	double ns_per_sample = 0.0;
+};
+
+static Result run_stage(const Stage& st, const std::vector<Stroke>& strokes, int latency_ms, float kalman_accel, int predict_max_px) {
+	Result r;
+	double lag_sum = 0.0, jit_sum = 0.0;
+	long lag_n = 0, jit_n = 0;
+	double over_sum = 0.0;
+	double cpu_ns = 0.0;
+	long samples = 0;
+	std::vector<float> ox, oy;
+
+	for (const Stroke& s : strokes) {
+		OneEuroFilter ex, ey;
+		ex.configure(st.euro_min_cutoff, st.euro_beta, 1.0f);
+		ey.configure(st.euro_min_cutoff, st.euro_beta, 1.0f);
+		KalmanTracker kx, ky;
+		kx.configure(kalman_accel, st.kalman_noise_px);
+		ky.configure(kalman_accel, st.kalman_noise_px);
+		float fx = 0.0f, fy = 0.0f;
+		ox.assign(s.size(), 0.0f);
+		oy.assign(s.size(), 0.0f);
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < s.size(); ++i) {
+			const float dt = i ? (float)(s[i].t_us - s[i - 1].t_us) * 1e-6f : 0.0f;
+			float x = s[i].x, y = s[i].y;
+			if (st.euro_min_cutoff > 0.0f) {
+				x = ex.filter(x, dt);
+				y = ey.filter(y, dt);
+			} else if (st.iir_alpha >= 0.0f) {
+				if (i == 0) {
+					fx = x;
+					fy = y;
+				}
+				fx += st.iir_alpha * (x - fx);
+				fy += st.iir_alpha * (y - fy);
+				x = fx;
+				y = fy;
+			}
+			if (st.kalman_noise_px > 0.0f) {
+				x = kx.update(x, dt);
+				y = ky.update(y, dt);
+				if (st.predict_ms > 0 && s[i].pressed) {
+					predict_ahead(kx, ky, st.predict_ms * 1e-3f, (float)predict_max_px, x, y);
+				}
+			}
+			ox[i] = x;
+			oy[i] = y;
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		cpu_ns += (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+		samples += (long)s.size();
+
+		for (size_t i = 1; i < s.size(); ++i) {
+			const float dt = (float)(s[i].t_us - s[i - 1].t_us) * 1e-6f;
+			const float speed = dt > 0.0f ? std::hypot(s[i].tx - s[i - 1].tx, s[i].ty - s[i - 1].ty) / dt : 0.0f;
+			if (speed > 50.0f) {
+				float rx = 0.0f, ry = 0.0f;
+				reference_at(s, s[i].t_us + latency_ms * 1000, rx, ry);
+				lag_sum += std::hypot(ox[i] - rx, oy[i] - ry);
+				lag_n++;
+			} else if (speed < 5.0f) {
+				jit_sum += (ox[i] - s[i].tx) * (ox[i] - s[i].tx) + (oy[i] - s[i].ty) * (oy[i] - s[i].ty);
+				jit_n++;
+			}
+		}
+
+		// Direction of travel over the stroke; overshoot is measured in the
+		// last 150 ms against the final reference position.
+		const Sample& last = s.back();
+		const float dx = last.tx - s.front().tx;
+		const float dy = last.ty - s.front().ty;
+		const float len = std::hypot(dx, dy);
+		double over = 0.0;
+		if (len > 20.0f) {
+			for (size_t i = 0; i < s.size(); ++i) {
+				if (last.t_us - s[i].t_us > 150000) continue;
+				const double d = ((ox[i] - last.tx) * dx + (oy[i] - last.ty) * dy) / len;
+				over = std::max(over, d);
+			}
+		}
+		over_sum += over;
+		r.overshoot_max_px = std::max(r.overshoot_max_px, over);
+	}
+	r.lag_px = lag_n ? lag_sum / lag_n : 0.0;
+	r.jitter_px = jit_n ? std::sqrt(jit_sum / jit_n) : 0.0;
+	r.overshoot_mean_px = strokes.empty() ? 0.0 : over_sum / strokes.size();
+	r.ns_per_sample = samples ? cpu_ns / samples : 0.0;
+	return r;
+}
+
+using GenericChain = Pipeline<Optional<DeltaClampStage>,
+							  Optional<MedianStage<0>>,
+							  Optional<IirStage>,
+							  Optional<OneEuroStage>,
+							  Optional<KalmanStage>>;
+
+static double chain_ns(FilterChain& c, const std::vector<Stroke>& strokes, int passes, std::vector<int>& out) {
+	out.clear();
+	auto t0 = std::chrono::steady_clock::now();
+	for (int k = 0; k < passes; ++k) {
+		for (const Stroke& s : strokes) {
+			c.reset();
+			for (const Sample& p : s) {
+				FilterSample fs;
+				fs.x = (int)std::lround(p.x);
+				fs.y = (int)std::lround(p.y);
+				fs.t_ns = p.t_us * 1000;
+				fs.pressed = p.pressed;
+				c.process(fs);
+				if (k == 0) {
+					out.push_back(fs.x);
+					out.push_back(fs.y);
+				}
+			}
+		}
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	size_t n = 0;
+	for (const auto& s : strokes) n += s.size();
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / (double)(n * passes);
+}
+
+static int check_chains(const std::vector<Stroke>& strokes) {
+	FilterParams base;
+	FilterParams configs[6] = {base, base, base, base, base, base};
+	configs[1].median_window = 5;
+	configs[2].median_window = 0;
+	configs[3].iir_alpha = 0.0f;
+	configs[4].euro_min_cutoff = 1.0f;
+	configs[5].iir_alpha = 0.0f;
+	configs[5].kalman_noise_px = 1.5f;
+	configs[5].predict_ms = 16;
+	int bad = 0;
+	std::vector<int> a, b;
+	std::printf("%-22s %12s %12s %s\n", "chain", "ns/sample", "generic", "outputs");
+	for (const FilterParams& p : configs) {
+		std::unique_ptr<FilterChain> fast = make_filter_chain(p);
+		GenericChain generic(p, "generic");
+		// Alternate the two and keep the best of each, so frequency ramps and
+		// other load hit both alike instead of whichever ran first.
+		double t_fast = 1e30, t_gen = 1e30;
+		for (int rep = 0; rep < 10; ++rep) {
+			t_fast = std::min(t_fast, chain_ns(*fast, strokes, 20, a));
+			t_gen = std::min(t_gen, chain_ns(generic, strokes, 20, b));
+		}
+		const bool same = a == b;
+		if (!same) bad++;
+		std::printf("%-22s %12.2f %12.2f %s\n", fast->name(), t_fast, t_gen, same ? "same" : "DIFFER");
+	}
+	return bad;
+}
+
+int main(int argc, char** argv) {
+	int latency_ms = 16;
+	int screen_w = 800, screen_h = 480;
+	int press = 120;
+	int predict_max_px = 24;
+	float kalman_accel = 30000.0f;
+	std::vector<std::string> traces;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--latency_ms") == 0 && i + 1 < argc) latency_ms = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--screen") == 0 && i + 1 < argc) std::sscanf(argv[++i], "%dx%d", &screen_w, &screen_h);
+		else if (strcmp(argv[i], "--press") == 0 && i + 1 < argc) press = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--kalman_accel") == 0 && i + 1 < argc) kalman_accel = std::strtof(argv[++i], nullptr);
+		else if (strcmp(argv[i], "--predict_max_px") == 0 && i + 1 < argc) predict_max_px = atoi(argv[++i]);
+		else traces.push_back(argv[i]);
+	}
+	screen_w = std::max(100, screen_w);
+	screen_h = std::max(100, screen_h);
+
+	std::vector<Stroke> strokes;
+	for (const auto& t : traces) {
+		if (!load_trace(t, screen_w, screen_h, press, strokes)) {
+			std::fprintf(stderr, "[ERROR] Cannot read trace %s\n", t.c_str());
+			return 1;
+		}
+	}
+	if (traces.empty()) strokes = synthetic_strokes(screen_w, screen_h);
+	if (strokes.empty()) {
+		std::fprintf(stderr, "[ERROR] No strokes found (press threshold %d).\n", press);
+		return 1;
+	}
+	size_t n = 0;
+	for (const auto& s : strokes) n += s.size();
+	std::printf("%s: %zu strokes, %zu samples, latency %d ms, predict_max_px %d\n",
+				traces.empty() ? "synthetic" : "recorded", strokes.size(), n, latency_ms, predict_max_px);
+
+	const Stage stages[] = {
+		{"raw", -1.0f, 0.0f, 0.0f, 0.0f, 0},
+		{"iir 0.2", 0.2f, 0.0f, 0.0f, 0.0f, 0},
+		{"iir 0.5", 0.5f, 0.0f, 0.0f, 0.0f, 0},
+		{"one euro 1/0.02", -1.0f, 1.0f, 0.02f, 0.0f, 0},
+		{"kalman", -1.0f, 0.0f, 0.0f, 1.5f, 0},
+		{"kalman +8ms", -1.0f, 0.0f, 0.0f, 1.5f, 8},
+		{"kalman +16ms", -1.0f, 0.0f, 0.0f, 1.5f, 16},
+		{"kalman +24ms", -1.0f, 0.0f, 0.0f, 1.5f, 24},
+		{"euro + kalman +16ms", -1.0f, 1.0f, 0.02f, 1.5f, 16},
+	};
+	std::printf("%-22s %10s %10s %14s %13s %10s\n", "stage", "lag_px", "jitter_px", "overshoot_avg", "overshoot_max", "ns/sample");
+	for (const Stage& st : stages) {
+		const Result r = run_stage(st, strokes, latency_ms, kalman_accel, predict_max_px);
+		std::printf("%-22s %10.2f %10.2f %14.2f %13.2f %10.1f\n", st.name, r.lag_px, r.jitter_px, r.overshoot_mean_px,
+					r.overshoot_max_px, r.ns_per_sample);
+	}
+	const int bad = check_chains(strokes);
+	return bad == 0 ? 0 : 1;
+}
@@ -0,0 +1,298 @@
+#include "xpt2046_transport.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/spi/spidev.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+
+// XPT2046 channel select bits (A2..A0) as used by our command bytes.
+enum Channel { CH_X = 1, CH_Z1 = 3, CH_Z2 = 4, CH_Y = 5 };
+
+// Fill rx the way the chip would: every byte with the start bit set is a
+// command, and its 12-bit result follows in the next two bytes (one busy
+// clock, then MSB first).
+template <typename ValueFn>
+void encode_responses(const uint8_t* tx, uint8_t* rx, size_t len, ValueFn value_for_channel) {
+	std::memset(rx, 0, len);
+	for (size_t i = 0; i + 2 < len; ++i) {
+		if (!(tx[i] & 0x80)) continue;
+		int ch = (tx[i] >> 4) & 0x7;
+		int v = value_for_channel(ch) & 0xFFF;
+		rx[i + 1] = (uint8_t)((v >> 5) & 0x7F);
+		rx[i + 2] = (uint8_t)((v << 3) & 0xF8);
+	}
+}
+
+template <typename T>
+T clamp_val(T v, T lo, T hi) {
+	return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+// Reduce one axis of a burst in place. Median is robust to single spikes; the
+// trimmed mean drops the lowest and highest quarter and averages the rest.
+int reduce_burst(int* v, int n, int reduce) {
+	if (n <= 1) return v[0];
+	std::sort(v, v + n);
+	if (reduce == 1) {
+		int trim = n / 4;
+		int sum = 0;
+		for (int i = trim; i < n - trim; ++i) sum += v[i];
+		return sum / (n - 2 * trim);
+	}
+	return v[n / 2];
+}
+
+const double kPi = 3.14159265358979323846;
+
+} // namespace
+
+SpidevTransport::~SpidevTransport() {
+	if (fd_ >= 0) close(fd_);
+}
+
+bool SpidevTransport::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+	struct spi_ioc_transfer tr = {};
+	tr.tx_buf = (unsigned long)tx;
+	tr.rx_buf = (unsigned long)rx;
+	tr.len = (uint32_t)len;
+	tr.speed_hz = 1000000;
+	tr.bits_per_word = 8;
+	tr.delay_usecs = 0;
+	return ioctl(fd_, SPI_IOC_MESSAGE(1), &tr) >= 1;
+}
+
+SimTransport::SimTransport(const SimParams& p) : p_(p), rng_(p.seed ? p.seed : 1) {}
+
+uint32_t SimTransport::next_u32() {
+	// xorshift32: cheap and identical on every platform.
+	uint32_t x = rng_;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rng_ = x;
+	return x;
+}
+
+float SimTransport::gauss() {
+	float u1 = ((next_u32() >> 8) + 1.0f) / 16777217.0f;
+	float u2 = (next_u32() >> 8) / 16777216.0f;
+	return std::sqrt(-2.0f * std::log(u1)) * std::cos(2.0f * (float)kPi * u2);
+}
+
+bool SimTransport::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+	const uint64_t period_us = (uint64_t)(p_.down_ms + p_.up_ms) * 1000;
+	const uint64_t in_period = period_us ? (t_us_ % period_us) : 0;
+	const bool down = in_period < (uint64_t)p_.down_ms * 1000;
+	const double phase = p_.down_ms > 0 ? (double)in_period / ((double)p_.down_ms * 1000.0) : 0.0;
+	t_us_ += (uint64_t)std::max(1, p_.step_us);
+
+	double px = p_.cx, py = p_.cy;
+	if (p_.stroke == "circle") {
+		px = p_.cx + p_.radius * std::cos(2.0 * kPi * phase);
+		py = p_.cy + p_.radius * std::sin(2.0 * kPi * phase);
+	} else if (p_.stroke == "line") {
+		px = p_.cx - p_.radius + 2.0 * p_.radius * phase;
+		py = p_.cy - p_.radius / 2.0 + p_.radius * phase;
+	}
+
+	encode_responses(tx, rx, len, [&](int ch) {
+		double base = 0.0;
+		double noise = p_.noise;
+		if (ch == CH_X) base = down ? px : 0.0;
+		else if (ch == CH_Y) base = down ? py : 0.0;
+		else if (ch == CH_Z1) base = down ? p_.pressure : 0.0;
+		else if (ch == CH_Z2) base = down ? 4095 - p_.pressure : 4095.0;
+		double v = base + noise * gauss();
+		if (p_.spike_pm > 0 && (int)(next_u32() % 1000) < p_.spike_pm) v = (next_u32() & 1) ? 4095.0 : 0.0;
+		return clamp_val((int)std::lround(v), 0, 4095);
+	});
+	return true;
+}
+
+bool ReplayTransport::transfer(const uint8_t* tx, uint8_t* rx, size_t len) {
+	if (samples_.empty()) return false;
+	const ReplaySample& s = samples_[pos_];
+	pos_ = (pos_ + 1) % samples_.size();
+	encode_responses(tx, rx, len, [&](int ch) {
+		if (ch == CH_X) return s.x;
+		if (ch == CH_Y) return s.y;
+		if (ch == CH_Z1) return s.z1;
+		if (ch == CH_Z2) return s.z2;
+		return 0;
+	});
+	return true;
+}
+
+bool load_replay_log(const std::string& path, std::vector<ReplaySample>& out) {
+	std::ifstream in(path);
+	if (!in.good()) return false;
+	std::string line;
+	int64_t t = 0;
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream iss(line);
+		int64_t v[5];
+		int n = 0;
+		while (n < 5 && (iss >> v[n])) ++n;
+		ReplaySample s;
+		if (n == 5) {
+			s.t_us = v[0];
+			s.x = (int)v[1];
+			s.y = (int)v[2];
+			s.z1 = (int)v[3];
+			s.z2 = (int)v[4];
+		} else if (n == 4) {
+			// No timestamps: assume the daemon's 200 Hz active rate.
+			s.t_us = t;
+			s.x = (int)v[0];
+			s.y = (int)v[1];
+			s.z1 = (int)v[2];
+			s.z2 = (int)v[3];
+		} else {
+			continue;
+		}
+		t = s.t_us + 5000;
+		out.push_back(s);
+	}
+	return !out.empty();
+}
+
+bool parse_sim_spec(const std::string& spec, SimParams& out, std::string& err) {
+	if (spec.rfind("sim", 0) != 0) {
+		err = "not a sim spec";
+		return false;
+	}
+	size_t colon = spec.find(':');
+	if (colon == std::string::npos) return true;
+	std::istringstream iss(spec.substr(colon + 1));
+	std::string kv;
+	while (std::getline(iss, kv, ',')) {
+		if (kv.empty()) continue;
+		size_t eq = kv.find('=');
+		if (eq == std::string::npos) {
+			err = "expected key=value: " + kv;
+			return false;
+		}
+		std::string key = kv.substr(0, eq);
+		std::string val = kv.substr(eq + 1);
+		int iv = std::atoi(val.c_str());
+		if (key == "stroke") out.stroke = val;
+		else if (key == "down_ms") out.down_ms = std::max(0, iv);
+		else if (key == "up_ms") out.up_ms = std::max(0, iv);
+		else if (key == "step_us") out.step_us = std::max(1, iv);
+		else if (key == "cx") out.cx = iv;
+		else if (key == "cy") out.cy = iv;
+		else if (key == "radius") out.radius = iv;
+		else if (key == "noise") out.noise = std::strtof(val.c_str(), nullptr);
+		else if (key == "spike_pm") out.spike_pm = iv;
+		else if (key == "pressure") out.pressure = iv;
+		else if (key == "seed") out.seed = (uint32_t)std::strtoul(val.c_str(), nullptr, 10);
+		else {
+			err = "unknown sim key: " + key;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool is_virtual_transport(const std::string& spec) {
+	return spec.rfind("sim", 0) == 0 || spec.rfind("replay:", 0) == 0;
+}
+
+std::unique_ptr<SpiTransport> open_transport(const std::string& spec, std::string& err) {
+	if (spec.rfind("sim", 0) == 0) {
+		SimParams p;
+		if (!parse_sim_spec(spec, p, err)) return nullptr;
+		return std::unique_ptr<SpiTransport>(new SimTransport(p));
+	}
+	if (spec.rfind("replay:", 0) == 0) {
+		std::string path = spec.substr(7);
+		std::vector<ReplaySample> samples;
+		if (!load_replay_log(path, samples)) {
+			err = "cannot read replay log " + path;
+			return nullptr;
+		}
+		return std::unique_ptr<SpiTransport>(new ReplayTransport(std::move(samples), path));
+	}
+
+	uint8_t mode = SPI_MODE_0;
+	uint32_t speed = 1000000;
+	int fd = open(spec.c_str(), O_RDWR);
+	if (fd < 0) {
+		err = std::string("open: ") + std::strerror(errno);
+		return nullptr;
+	}
+	if (ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0) {
+		err = std::string("ioctl(SPI_IOC_WR_MODE): ") + std::strerror(errno);
+		close(fd);
+		return nullptr;
+	}
+	if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+		err = std::string("ioctl(SPI_IOC_WR_MAX_SPEED_HZ): ") + std::strerror(errno);
+		close(fd);
+		return nullptr;
+	}
+	return std::unique_ptr<SpiTransport>(new SpidevTransport(fd, spec));
+}
+
+std::unique_ptr<SpiTransport> open_spi_best(const std::string& spi_device_cfg, std::string& used_device) {
+	std::vector<std::string> candidates;
+	if (!spi_device_cfg.empty()) candidates.push_back(spi_device_cfg);
+	candidates.push_back("/dev/spidev0.1");
+	candidates.push_back("/dev/spidev0.0");
+	candidates.push_back("/dev/spidev1.0");
+	candidates.push_back("/dev/spidev1.1");
+
+	for (const auto& dev : candidates) {
+		std::string err;
+		std::unique_ptr<SpiTransport> t = open_transport(dev, err);
+		if (!t) continue;
+		used_device = t->name();
+		return t;
+	}
+	return nullptr;
+}
+
+int read_xpt2046(SpiTransport& spi, uint8_t command) {
+	uint8_t tx[3] = {command, 0x00, 0x00};
+	uint8_t rx[3] = {0};
+	if (!spi.transfer(tx, rx, sizeof(tx))) return -1;
+	return ((rx[1] << 5) | (rx[2] >> 3)) & 0xFFF;
+}
+
+bool read_xpt2046_burst(SpiTransport& spi, int n_xy, int n_z, int reduce, Xpt2046Frame& out) {
+	static const uint8_t cmds[4] = {0x90, 0xD0, 0xB0, 0xC0};
+	n_xy = clamp_val(n_xy, 1, 16);
+	n_z = clamp_val(n_z, 1, 16);
+	const int counts[4] = {n_xy, n_xy, n_z, n_z};
+	uint8_t tx[2 * 64 + 1] = {0};
+	uint8_t rx[2 * 64 + 1] = {0};
+	int n = 0;
+	for (int a = 0; a < 4; ++a) {
+		for (int k = 0; k < counts[a]; ++k) tx[2 * n++] = cmds[a];
+	}
+	if (!spi.transfer(tx, rx, (size_t)(2 * n + 1))) {
+		out = Xpt2046Frame();
+		return false;
+	}
+	int* dst[4] = {&out.x, &out.y, &out.z1, &out.z2};
+	int vals[16];
+	int pos = 0;
+	for (int a = 0; a < 4; ++a) {
+		for (int k = 0; k < counts[a]; ++k, ++pos) {
+			vals[k] = ((rx[pos * 2 + 1] << 5) | (rx[pos * 2 + 2] >> 3)) & 0xFFF;
+		}
+		*dst[a] = reduce_burst(vals, counts[a], reduce);
+	}
+	return true;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Byte-level SPI transport for the XPT2046. Every backend answers the same
+// command bytes, so the frame/burst readers and everything above them run
+// unchanged on real hardware, in the simulator or from a recorded log.
+class SpiTransport {
+public:
+	virtual ~SpiTransport() = default;
+
+	// One full-duplex SPI message of len bytes (chip select held throughout).
+	virtual bool transfer(const uint8_t* tx, uint8_t* rx, size_t len) = 0;
+
+	virtual std::string name() const = 0;
+};
+
+// /dev/spidevX.Y backend (mode 0, 1 MHz).
+class SpidevTransport : public SpiTransport {
+public:
+	SpidevTransport(int fd, std::string path) : fd_(fd), path_(std::move(path)) {}
+	~SpidevTransport() override;
+	bool transfer(const uint8_t* tx, uint8_t* rx, size_t len) override;
+	std::string name() const override { return path_; }
+
+private:
+	int fd_;
+	std::string path_;
+};
+
+// Deterministic touch simulator. Each transfer() is one sampling instant and
+// advances virtual time by step_us; every conversion gets fresh noise.
+struct SimParams {
+	std::string stroke = "circle"; // circle | line | hold
+	int down_ms = 800; // contact time per stroke
+	int up_ms = 400; // lift time between strokes
+	int step_us = 5000; // virtual time per SPI message
+	int cx = 2048; // stroke centre, raw units
+	int cy = 2048;
+	int radius = 1200; // stroke size, raw units
+	float noise = 6.0f; // per-conversion std deviation, raw units
+	int spike_pm = 0; // outlier conversions per mille
+	int pressure = 600; // Z1 while touching
+	uint32_t seed = 1;
+};
+
+class SimTransport : public SpiTransport {
+public:
+	explicit SimTransport(const SimParams& p);
+	bool transfer(const uint8_t* tx, uint8_t* rx, size_t len) override;
+	std::string name() const override { return "sim"; }
+
+private:
+	float gauss();
+	uint32_t next_u32();
+
+	SimParams p_;
+	uint64_t t_us_ = 0;
+	uint32_t rng_;
+};
+
+// One recorded sample: acquisition time and the four conversions.
+struct ReplaySample {
+	int64_t t_us = 0;
+	int x = 0;
+	int y = 0;
+	int z1 = 0;
+	int z2 = 4095;
+};
+
+// Replays a sample log (lines "t_us x y z1 z2" or "x y z1 z2", '#' comments),
+// one record per transfer(), looping at the end.
+class ReplayTransport : public SpiTransport {
+public:
+	ReplayTransport(std::vector<ReplaySample> samples, std::string path)
+		: samples_(std::move(samples)), path_(std::move(path)) {}
+	bool transfer(const uint8_t* tx, uint8_t* rx, size_t len) override;
+	std::string name() const override { return "replay:" + path_; }
+
+	const std::vector<ReplaySample>& samples() const { return samples_; }
+
+private:
+	std::vector<ReplaySample> samples_;
+	std::string path_;
+	size_t pos_ = 0;
+};
+
+bool load_replay_log(const std::string& path, std::vector<ReplaySample>& out);
+
+// Parse "sim[:key=val,...]" into params; returns false on unknown keys.
+bool parse_sim_spec(const std::string& spec, SimParams& out, std::string& err);
+
+// True for "sim..." and "replay:..." specs (no /dev node involved).
+bool is_virtual_transport(const std::string& spec);
+
+// Open one backend from a spi_device value: a /dev/spidev path, "sim[:...]"
+// or "replay:<path>". Returns nullptr and fills err on failure.
+std::unique_ptr<SpiTransport> open_transport(const std::string& spec, std::string& err);
+
+// Try the configured device first, then the usual spidev nodes.
+std::unique_ptr<SpiTransport> open_spi_best(const std::string& spi_device_cfg, std::string& used_device);
+
+struct Xpt2046Frame {
+	int x = -1;
+	int y = -1;
+	int z1 = -1;
+	int z2 = -1;
+};
+
+// Single conversion (3-byte message). Returns the 12-bit value or -1.
+int read_xpt2046(SpiTransport& spi, uint8_t command);
+
+// X, Y, Z1 and Z2 in one SPI message using the 16-clocks-per-conversion
+// overlap: each command byte is shifted out while the tail of the previous
+// result is still coming in, so N conversions take 2*N+1 bytes.
+// With n_xy/n_z > 1 (max 16) each axis is oversampled inside the same
+// message and reduced (reduce 0 = median, 1 = trimmed mean).
+bool read_xpt2046_burst(SpiTransport& spi, int n_xy, int n_z, int reduce, Xpt2046Frame& out);
+
+inline bool read_xpt2046_frame(SpiTransport& spi, Xpt2046Frame& out) {
+	return read_xpt2046_burst(spi, 1, 1, 0, out);
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <linux/input.h>
+#include <time.h>
+#include <unistd.h>
+
+// Collects the events of one input frame and hands them to uinput in a
+// single write() ending with SYN_REPORT. ABS values equal to the last one
+// written are left out (evdev would drop them anyway), and a frame with
+// nothing left in it is not written at all.
+//
+// uinput stamps events with the time it receives them and ignores
+// input_event.time, so the acquisition time travels as MSC_TIMESTAMP
+// (CLOCK_MONOTONIC microseconds, wrapping at 32 bits) in every frame.
+class UinputBatch {
+public:
+	static constexpr size_t kMaxEvents = 16;
+
+	// Queue an event unconditionally (keys, tracking IDs).
+	void add(uint16_t type, uint16_t code, int32_t value) {
+		if (n_ >= kMaxEvents - 2) return; // keep room for MSC_TIMESTAMP + SYN_REPORT
+		push(type, code, value);
+	}
+
+	// Queue an ABS event only if the value changed since the last write.
+	void abs(uint16_t code, int32_t value) {
+		if (code >= ABS_CNT) return;
+		if (have_[code] && last_[code] == value) return;
+		add(EV_ABS, code, value);
+	}
+
+	// CLOCK_MONOTONIC time the frame's sample was taken at.
+	void timestamp(int64_t t_ns) { t_ns_ = t_ns; }
+
+	// Forget what was written so the next frame carries every axis again
+	// (new contact, new device).
+	void invalidate() { std::memset(have_, 0, sizeof(have_)); }
+
+	// Write the queued events plus SYN_REPORT. Returns false if the frame was
+	// empty (suppressed) or the write failed.
+	bool submit(int fd) {
+		if (n_ == 0) {
+			frames_suppressed_++;
+			return false;
+		}
+		if (t_ns_ > 0) push(EV_MSC, MSC_TIMESTAMP, (int32_t)(uint32_t)(t_ns_ / 1000));
+		const size_t queued = n_;
+		push(EV_SYN, SYN_REPORT, 0);
+		const ssize_t len = (ssize_t)(n_ * sizeof(input_event));
+		ssize_t w;
+		do {
+			w = write(fd, buf_, (size_t)len);
+		} while (w < 0 && errno == EINTR);
+		n_ = 0;
+		if (w != len) {
+			write_errors_++;
+			invalidate();
+			return false;
+		}
+		for (size_t i = 0; i < queued; ++i) {
+			if (buf_[i].type != EV_ABS) continue;
+			have_[buf_[i].code] = true;
+			last_[buf_[i].code] = buf_[i].value;
+		}
+		frames_written_++;
+		events_written_ += queued + 1;
+		if (t_ns_ > 0) {
+			timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			const int64_t lag = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec - t_ns_;
+			lag_sum_ns_ += lag;
+			if (lag > lag_max_ns_) lag_max_ns_ = lag;
+			lag_frames_++;
+		}
+		return true;
+	}
+
+	uint64_t frames_written() const { return frames_written_; }
+	uint64_t frames_suppressed() const { return frames_suppressed_; }
+	uint64_t events_written() const { return events_written_; }
+	uint64_t write_errors() const { return write_errors_; }
+	// Acquisition-to-write delay of the frames written so far.
+	double mean_lag_us() const { return lag_frames_ ? (double)lag_sum_ns_ / (double)lag_frames_ / 1000.0 : 0.0; }
+	int64_t max_lag_us() const { return lag_max_ns_ / 1000; }
+
+private:
+	void push(uint16_t type, uint16_t code, int32_t value) {
+		input_event& ev = buf_[n_++];
+		std::memset(&ev, 0, sizeof(ev));
+		ev.type = type;
+		ev.code = code;
+		ev.value = value;
+	}
+
+	input_event buf_[kMaxEvents];
+	size_t n_ = 0;
+	int64_t t_ns_ = 0;
+	bool have_[ABS_CNT] = {};
+	int32_t last_[ABS_CNT] = {};
+	uint64_t frames_written_ = 0;
+	uint64_t frames_suppressed_ = 0;
+	uint64_t events_written_ = 0;
+	uint64_t write_errors_ = 0;
+	int64_t lag_sum_ns_ = 0;
+	int64_t lag_max_ns_ = 0;
+	uint64_t lag_frames_ = 0;
+};
+
+// Deadband on the reported pressure. Z1 jitters by a few counts on every
+// sample, which would make nearly every frame of a resting finger carry a
+// new ABS_MT_PRESSURE and defeat the duplicate suppression of UinputBatch.
+// The reported value only follows once it moves kStep or more.
+class PressureHysteresis {
+public:
+	static constexpr int kStep = 16;
+
+	// New contact: report the first value as it is.
+	void reset() { have_ = false; }
+
+	int update(int pressure) {
+		if (!have_ || std::abs(pressure - reported_) >= kStep) {
+			reported_ = pressure;
+			have_ = true;
+		}
+		return reported_;
+	}
+
+private:
+	int reported_ = 0;
+	bool have_ = false;
+};
+
+// Spread of the emitted position while the finger rests, to size the ABS
+// fuzz. Samples are taken in windows of kWindow; a window whose range stays
+// within kMaxRangePx on both axes counts as stationary and adds its
+// per-axis variance. ready() after kWindowsNeeded such windows.
+class StationaryNoise {
+public:
+	static constexpr int kWindow = 32;
+	static constexpr int kMaxRangePx = 6;
+	static constexpr int kWindowsNeeded = 4;
+
+	void reset() {
+		n_ = 0;
+		windows_ = 0;
+		var_x_ = var_y_ = 0.0;
+	}
+
+	// Contact ended: a window must not span two touches.
+	void restart_window() { n_ = 0; }
+
+	void add(int x, int y) {
+		xs_[n_] = x;
+		ys_[n_] = y;
+		if (++n_ < kWindow) return;
+		n_ = 0;
+		double vx = 0.0, vy = 0.0;
+		if (!stationary(xs_, vx) || !stationary(ys_, vy)) return;
+		var_x_ += vx;
+		var_y_ += vy;
+		windows_++;
+	}
+
+	bool ready() const { return windows_ >= kWindowsNeeded; }
+	double std_x() const { return windows_ ? std::sqrt(var_x_ / windows_) : 0.0; }
+	double std_y() const { return windows_ ? std::sqrt(var_y_ / windows_) : 0.0; }
+
+	// Twice the standard deviation, at least 1: the kernel then drops
+	// changes under one sigma and damps those under two.
+	static int fuzz_for(double std_px) { return std::max(1, (int)std::lround(2.0 * std_px)); }
+
+private:
+	static bool stationary(const int* v, double& var) {
+		int lo = v[0], hi = v[0];
+		double sum = 0.0;
+		for (int i = 0; i < kWindow; ++i) {
+			lo = std::min(lo, v[i]);
+			hi = std::max(hi, v[i]);
+			sum += v[i];
+		}
+		if (hi - lo > kMaxRangePx) return false;
+		const double mean = sum / kWindow;
+		double sq = 0.0;
+		for (int i = 0; i < kWindow; ++i) sq += (v[i] - mean) * (v[i] - mean);
+		var = sq / (kWindow - 1);
+		return true;
+	}
+
+	int xs_[kWindow];
+	int ys_[kWindow];
+	int n_ = 0;
+	int windows_ = 0;
+	double var_x_ = 0.0;
+	double var_y_ = 0.0;
+};
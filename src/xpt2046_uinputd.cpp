@@ -1,124 +1,57 @@
 #include <algorithm>
 #include <atomic>
 #include <cerrno>
-#include <chrono>
 #include <cmath>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
-#include <fcntl.h>
 #include <linux/input.h>
-#include <linux/spi/spidev.h>
 #include <linux/uinput.h>
+#include <malloc.h>
+#include <memory>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sstream>
 #include <string>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <thread>
+#include <time.h>
 #include <unistd.h>
 #include <vector>
 
+#include "xpt2046_alloc_check.h"
+#include "xpt2046_config.h"
+#include "xpt2046_config_snapshot.h"
+#include "xpt2046_config_watch.h"
+#include "xpt2046_ctl.h"
+#include "xpt2046_feed.h"
+#include "xpt2046_mapping.h"
+#include "xpt2046_penirq.h"
+#include "xpt2046_pipeline.h"
+#include "xpt2046_ring.h"
+#include "xpt2046_sched.h"
+#include "xpt2046_touch_state.h"
+#include "xpt2046_transport.h"
+#include "xpt2046_uinput.h"
+
 static std::atomic<bool> g_running{true};
+static std::atomic<bool> g_dump_stats{false};
 
 static void handle_signal(int) {
 	g_running = false;
 }
 
-static std::string get_exe_dir() {
-	char buf[4096];
-	ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
-	if (n <= 0) return std::string();
-	buf[n] = '\0';
-	std::string path(buf);
-	size_t pos = path.find_last_of('/');
-	if (pos == std::string::npos) return std::string();
-	return path.substr(0, pos);
-}
-
-static std::string find_config_path() {
-	const char* envPath = getenv("TOUCH_CONFIG_PATH");
-	if (envPath && *envPath) {
-		std::ifstream f(envPath);
-		if (f.good()) return std::string(envPath);
-	}
-
-	std::vector<std::string> candidates;
-	// System-wide config (useful when running as a system service)
-	candidates.push_back("/etc/xpt2046/touch_config.txt");
-	candidates.push_back("touch_config.txt");
-	candidates.push_back("installation/touch_config.txt");
-
-	std::string exeDir = get_exe_dir();
-	if (!exeDir.empty()) {
-		candidates.push_back(exeDir + "/touch_config.txt");
-		candidates.push_back(exeDir + "/installation/touch_config.txt");
-		candidates.push_back(exeDir + "/../installation/touch_config.txt");
-	}
-
-	for (const auto& p : candidates) {
-		std::ifstream f(p);
-		if (f.good()) return p;
-	}
-	return std::string();
-}
-
-static bool parse_int(const std::string& s, int& out) {
-	char* end = nullptr;
-	long v = std::strtol(s.c_str(), &end, 10);
-	if (end == s.c_str()) return false;
-	out = (int)v;
-	return true;
-}
-
-static bool parse_float(const std::string& s, float& out) {
-	char* end = nullptr;
-	float v = std::strtof(s.c_str(), &end);
-	if (end == s.c_str()) return false;
-	out = v;
-	return true;
-}
-
-template <typename T>
-static T clamp_val(T v, T lo, T hi) {
-	return (v < lo) ? lo : ((v > hi) ? hi : v);
-}
-
-struct AdvancedParams {
-	int screen_w = 800;
-	int screen_h = 480;
-	int poll_us = 100000;
-
-	int offset_x = 0;
-	int offset_y = 0;
-	float scale_x = 1.0f;
-	float scale_y = 1.0f;
-
-	int deadzone_left = 0;
-	int deadzone_right = 0;
-	int deadzone_top = 0;
-	int deadzone_bottom = 0;
-
-	int median_window = 3;
-	float iir_alpha = 0.20f;
-
-	int press_threshold = 120;
-	int release_threshold = 80;
-
-	int max_delta_px = 0;
-};
-
-static void sanitize_adv(AdvancedParams& adv) {
-	adv.screen_w = clamp_val(adv.screen_w, 1, 4096);
-	adv.screen_h = clamp_val(adv.screen_h, 1, 4096);
-	adv.poll_us = clamp_val(adv.poll_us, 1000, 1000000);
-	adv.scale_x = clamp_val(adv.scale_x, 0.01f, 10.0f);
-	adv.scale_y = clamp_val(adv.scale_y, 0.01f, 10.0f);
-	adv.iir_alpha = clamp_val(adv.iir_alpha, 0.0f, 1.0f);
-	if (!(adv.median_window == 0 || adv.median_window == 3 || adv.median_window == 5)) adv.median_window = 3;
-	if (adv.release_threshold > adv.press_threshold) adv.release_threshold = adv.press_threshold;
+static void handle_stats_signal(int) {
+	g_dump_stats = true;
 }
 
 static bool stat_mtime(const std::string& path, timespec& out) {
@@ -133,161 +66,75 @@ static bool timespec_differs(const timespec& a, const timespec& b) {
 	return a.tv_sec != b.tv_sec || a.tv_nsec != b.tv_nsec;
 }
 
-static void load_config(int& invert_x,
-						int& invert_y,
-						int& swap_xy,
-						int& min_x,
-						int& max_x,
-						int& min_y,
-						int& max_y,
-						AdvancedParams& adv,
-						std::string& usedPath,
-						std::string& spi_device_cfg) {
-	invert_x = invert_y = swap_xy = 0;
-	min_x = min_y = 0;
-	max_x = max_y = 4095;
-
-	usedPath = find_config_path();
-	if (usedPath.empty()) return;
-
-	std::ifstream file(usedPath);
-	std::string line;
-	while (std::getline(file, line)) {
-		if (line.empty() || line[0] == '#') continue;
-		auto eq = line.find('=');
-		if (eq == std::string::npos) continue;
-		std::string key = line.substr(0, eq);
-		std::string val = line.substr(eq + 1);
-		int iv = 0;
-		float fv = 0.0f;
-
-		if (key == "invert_x" && parse_int(val, iv)) invert_x = iv;
-		else if (key == "invert_y" && parse_int(val, iv)) invert_y = iv;
-		else if (key == "swap_xy" && parse_int(val, iv)) swap_xy = iv;
-		else if (key == "min_x" && parse_int(val, iv)) min_x = iv;
-		else if (key == "max_x" && parse_int(val, iv)) max_x = iv;
-		else if (key == "min_y" && parse_int(val, iv)) min_y = iv;
-		else if (key == "max_y" && parse_int(val, iv)) max_y = iv;
-		else if (key == "spi_device") spi_device_cfg = val;
-		else if (key == "screen_w" && parse_int(val, iv)) adv.screen_w = iv;
-		else if (key == "screen_h" && parse_int(val, iv)) adv.screen_h = iv;
-		else if (key == "poll_us" && parse_int(val, iv)) adv.poll_us = iv;
-		else if (key == "offset_x" && parse_int(val, iv)) adv.offset_x = iv;
-		else if (key == "offset_y" && parse_int(val, iv)) adv.offset_y = iv;
-		else if (key == "scale_x" && parse_float(val, fv)) adv.scale_x = fv;
-		else if (key == "scale_y" && parse_float(val, fv)) adv.scale_y = fv;
-		else if (key == "deadzone_left" && parse_int(val, iv)) adv.deadzone_left = iv;
-		else if (key == "deadzone_right" && parse_int(val, iv)) adv.deadzone_right = iv;
-		else if (key == "deadzone_top" && parse_int(val, iv)) adv.deadzone_top = iv;
-		else if (key == "deadzone_bottom" && parse_int(val, iv)) adv.deadzone_bottom = iv;
-		else if (key == "median_window" && parse_int(val, iv)) adv.median_window = iv;
-		else if (key == "iir_alpha" && parse_float(val, fv)) adv.iir_alpha = fv;
-		else if (key == "press_threshold" && parse_int(val, iv)) adv.press_threshold = iv;
-		else if (key == "release_threshold" && parse_int(val, iv)) adv.release_threshold = iv;
-		else if (key == "max_delta_px" && parse_int(val, iv)) adv.max_delta_px = iv;
-	}
-}
-
-static void apply_env_overrides(int& invert_x,
-							int& invert_y,
-							int& swap_xy,
-							int& min_x,
-							int& max_x,
-							int& min_y,
-							int& max_y,
-							AdvancedParams& adv,
-							std::string& spi_device_cfg) {
-	auto env_i = [](const char* name, int& dst) {
-		const char* v = getenv(name);
-		if (v && *v) dst = std::atoi(v);
-	};
-	auto env_f = [](const char* name, float& dst) {
-		const char* v = getenv(name);
-		if (v && *v) dst = std::strtof(v, nullptr);
-	};
-
-	if (const char* v = getenv("XPT_SPI_DEVICE")) {
-		if (*v) spi_device_cfg = v;
-	}
-
-	env_i("XPT_INVERT_X", invert_x);
-	env_i("XPT_INVERT_Y", invert_y);
-	env_i("XPT_SWAP_XY", swap_xy);
-	env_i("XPT_MIN_X", min_x);
-	env_i("XPT_MAX_X", max_x);
-	env_i("XPT_MIN_Y", min_y);
-	env_i("XPT_MAX_Y", max_y);
-	env_i("XPT_SCREEN_W", adv.screen_w);
-	env_i("XPT_SCREEN_H", adv.screen_h);
-	env_i("XPT_POLL_US", adv.poll_us);
-	env_i("XPT_OFFSET_X", adv.offset_x);
-	env_i("XPT_OFFSET_Y", adv.offset_y);
-	env_f("XPT_SCALE_X", adv.scale_x);
-	env_f("XPT_SCALE_Y", adv.scale_y);
-	env_i("XPT_DEADZONE_LEFT", adv.deadzone_left);
-	env_i("XPT_DEADZONE_RIGHT", adv.deadzone_right);
-	env_i("XPT_DEADZONE_TOP", adv.deadzone_top);
-	env_i("XPT_DEADZONE_BOTTOM", adv.deadzone_bottom);
-	env_i("XPT_MEDIAN_WINDOW", adv.median_window);
-	env_f("XPT_IIR_ALPHA", adv.iir_alpha);
-	env_i("XPT_PRESS_THRESHOLD", adv.press_threshold);
-	env_i("XPT_RELEASE_THRESHOLD", adv.release_threshold);
-	env_i("XPT_MAX_DELTA_PX", adv.max_delta_px);
-}
-
-static int read_xpt2046(int spi_fd, uint8_t command) {
-	uint8_t tx[3] = {command, 0x00, 0x00};
-	uint8_t rx[3] = {0};
-	struct spi_ioc_transfer tr = {};
-	tr.tx_buf = (unsigned long)tx;
-	tr.rx_buf = (unsigned long)rx;
-	tr.len = 3;
-	tr.speed_hz = 1000000;
-	tr.bits_per_word = 8;
-	tr.delay_usecs = 0;
-	int ret = ioctl(spi_fd, SPI_IOC_MESSAGE(1), &tr);
-	if (ret < 1) return -1;
-	int value = ((rx[1] << 5) | (rx[2] >> 3)) & 0xFFF;
-	return value;
+static bool uinput_setup_abs(int fd, uint16_t code, int min, int max, int fuzz, int resolution) {
+	struct uinput_abs_setup abs;
+	std::memset(&abs, 0, sizeof(abs));
+	abs.code = code;
+	abs.absinfo.minimum = min;
+	abs.absinfo.maximum = max;
+	abs.absinfo.fuzz = fuzz;
+	abs.absinfo.flat = 0; // flat is a joystick centre deadzone; meaningless for a touchscreen
+	abs.absinfo.resolution = resolution;
+	return ioctl(fd, UI_SET_ABSBIT, code) == 0 && ioctl(fd, UI_ABS_SETUP, &abs) == 0;
 }
 
-static int open_spi_best(const std::string& spi_device_cfg, std::string& used_device) {
-	std::vector<std::string> candidates;
-	if (!spi_device_cfg.empty()) candidates.push_back(spi_device_cfg);
-	candidates.push_back("/dev/spidev0.1");
-	candidates.push_back("/dev/spidev0.0");
-	candidates.push_back("/dev/spidev1.0");
-	candidates.push_back("/dev/spidev1.1");
-
-	uint8_t mode = SPI_MODE_0;
-	uint32_t speed = 1000000;
-
-	for (const auto& dev : candidates) {
-		int fd = open(dev.c_str(), O_RDWR);
-		if (fd < 0) continue;
-		if (ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0) {
-			close(fd);
-			continue;
+// Wait until the evdev handler has bound to the new device (its eventN
+// directory shows up in sysfs) and the /dev node exists, instead of
+// sleeping a fixed time. Fills event_node; false on timeout.
+static bool uinput_wait_ready(int fd, std::string& event_node, int64_t& waited_us) {
+	const int64_t t0 = monotonic_ns();
+	waited_us = 0;
+	char sysname[64] = {};
+	if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) return false;
+	const std::string dir = std::string("/sys/devices/virtual/input/") + sysname;
+	for (int attempt = 0; attempt < 1000; ++attempt) {
+		if (event_node.empty()) {
+			if (DIR* d = opendir(dir.c_str())) {
+				while (dirent* e = readdir(d)) {
+					if (std::strncmp(e->d_name, "event", 5) == 0) {
+						event_node = std::string("/dev/input/") + e->d_name;
+						break;
+					}
+				}
+				closedir(d);
+			}
 		}
-		if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
-			close(fd);
-			continue;
+		struct stat st;
+		if (!event_node.empty() && stat(event_node.c_str(), &st) == 0) {
+			waited_us = (monotonic_ns() - t0) / 1000;
+			return true;
 		}
-		used_device = dev;
-		return fd;
+		usleep(1000);
 	}
-	return -1;
+	waited_us = (monotonic_ns() - t0) / 1000;
+	return false;
 }
 
-static int uinput_create_touch(int screen_w, int screen_h) {
+// fuzz_px > 0 sets the position fuzz up front (the kernel then drops
+// changes below half of it); resolution comes from the panel size in mm
+// when known.
+static int uinput_create_touch(const AdvancedParams& adv, int fuzz_px, std::string& event_node) {
 	int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
 	if (fd < 0) {
 		std::perror("open(/dev/uinput)");
 		return -1;
 	}
 
-	const int max_x = std::max(0, screen_w - 1);
-	const int max_y = std::max(0, screen_h - 1);
+	const int max_x = std::max(0, adv.screen_w - 1);
+	const int max_y = std::max(0, adv.screen_h - 1);
+	const int res_x = adv.panel_width_mm > 0 ? (int)std::lround((double)adv.screen_w / adv.panel_width_mm) : 0;
+	const int res_y = adv.panel_height_mm > 0 ? (int)std::lround((double)adv.screen_h / adv.panel_height_mm) : 0;
+	const int fuzz = std::max(0, fuzz_px);
+
+	uinput_setup setup;
+	std::memset(&setup, 0, sizeof(setup));
+	std::snprintf(setup.name, sizeof(setup.name), "XPT2046 uinput touch");
+	setup.id.bustype = BUS_USB;
+	setup.id.vendor = 0x1234;
+	setup.id.product = 0x5678;
+	setup.id.version = 1;
+
+	int64_t waited_us = 0;
 
 	// Mark as a direct touch device (not a touchpad)
 	(void)ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT);
@@ -297,48 +144,31 @@ static int uinput_create_touch(int screen_w, int screen_h) {
 	// Some stacks expect TOOL_FINGER for touchscreens
 	(void)ioctl(fd, UI_SET_KEYBIT, BTN_TOOL_FINGER);
 	if (ioctl(fd, UI_SET_EVBIT, EV_ABS) < 0) goto fail;
-	if (ioctl(fd, UI_SET_ABSBIT, ABS_X) < 0) goto fail;
-	if (ioctl(fd, UI_SET_ABSBIT, ABS_Y) < 0) goto fail;
+	if (!uinput_setup_abs(fd, ABS_X, 0, max_x, fuzz, res_x)) goto fail;
+	if (!uinput_setup_abs(fd, ABS_Y, 0, max_y, fuzz, res_y)) goto fail;
 
 	// Multitouch-style reporting (works well with SDL/Qt/evdev)
-	(void)ioctl(fd, UI_SET_ABSBIT, ABS_MT_SLOT);
-	(void)ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_X);
-	(void)ioctl(fd, UI_SET_ABSBIT, ABS_MT_POSITION_Y);
-	(void)ioctl(fd, UI_SET_ABSBIT, ABS_MT_TRACKING_ID);
-	(void)ioctl(fd, UI_SET_ABSBIT, ABS_MT_PRESSURE);
+	(void)uinput_setup_abs(fd, ABS_MT_SLOT, 0, 0, 0, 0);
+	(void)uinput_setup_abs(fd, ABS_MT_POSITION_X, 0, max_x, fuzz, res_x);
+	(void)uinput_setup_abs(fd, ABS_MT_POSITION_Y, 0, max_y, fuzz, res_y);
+	(void)uinput_setup_abs(fd, ABS_MT_TRACKING_ID, 0, 65535, 0, 0);
+	(void)uinput_setup_abs(fd, ABS_MT_PRESSURE, 0, 4095, 0, 0);
+
+	// Acquisition time of each frame (see UinputBatch).
+	(void)ioctl(fd, UI_SET_EVBIT, EV_MSC);
+	(void)ioctl(fd, UI_SET_MSCBIT, MSC_TIMESTAMP);
 
 	if (ioctl(fd, UI_SET_EVBIT, EV_SYN) < 0) goto fail;
 
-	uinput_user_dev uidev;
-	std::memset(&uidev, 0, sizeof(uidev));
-	std::snprintf(uidev.name, sizeof(uidev.name), "XPT2046 uinput touch");
-	uidev.id.bustype = BUS_USB;
-	uidev.id.vendor = 0x1234;
-	uidev.id.product = 0x5678;
-	uidev.id.version = 1;
-
-	uidev.absmin[ABS_X] = 0;
-	uidev.absmax[ABS_X] = max_x;
-	uidev.absmin[ABS_Y] = 0;
-	uidev.absmax[ABS_Y] = max_y;
-
-	uidev.absmin[ABS_MT_SLOT] = 0;
-	uidev.absmax[ABS_MT_SLOT] = 0;
-
-	uidev.absmin[ABS_MT_POSITION_X] = 0;
-	uidev.absmax[ABS_MT_POSITION_X] = max_x;
-	uidev.absmin[ABS_MT_POSITION_Y] = 0;
-	uidev.absmax[ABS_MT_POSITION_Y] = max_y;
-	uidev.absmin[ABS_MT_TRACKING_ID] = 0;
-	uidev.absmax[ABS_MT_TRACKING_ID] = 65535;
-	uidev.absmin[ABS_MT_PRESSURE] = 0;
-	uidev.absmax[ABS_MT_PRESSURE] = 4095;
-
-	if (write(fd, &uidev, sizeof(uidev)) < 0) goto fail;
+	if (ioctl(fd, UI_DEV_SETUP, &setup) < 0) goto fail;
 	if (ioctl(fd, UI_DEV_CREATE) < 0) goto fail;
 
-	// Give the input subsystem a moment
-	usleep(100000);
+	if (uinput_wait_ready(fd, event_node, waited_us)) {
+		std::cerr << "[INFO] uinput device ready at " << event_node << " after " << waited_us << " us." << std::endl;
+	} else {
+		std::cerr << "[WARN] uinput device not visible in sysfs after " << waited_us / 1000
+				  << " ms; fuzz cannot be tuned at runtime." << std::endl;
+	}
 	return fd;
 
 fail:
@@ -347,351 +177,659 @@ fail:
 	return -1;
 }
 
-static void uinput_emit(int fd, uint16_t type, uint16_t code, int32_t value) {
-	input_event ev;
-	std::memset(&ev, 0, sizeof(ev));
-	ev.type = type;
-	ev.code = code;
-	ev.value = value;
-	// time left as 0; kernel fills / not required
-	(void)write(fd, &ev, sizeof(ev));
+// Change the position fuzz of the live device through its evdev node.
+static bool uinput_set_fuzz(const std::string& event_node, int fuzz_x, int fuzz_y) {
+	if (event_node.empty()) return false;
+	int fd = open(event_node.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) return false;
+	bool ok = true;
+	const struct {
+		int code;
+		int fuzz;
+	} axes[] = {{ABS_X, fuzz_x}, {ABS_Y, fuzz_y}, {ABS_MT_POSITION_X, fuzz_x}, {ABS_MT_POSITION_Y, fuzz_y}};
+	for (const auto& a : axes) {
+		input_absinfo info;
+		if (ioctl(fd, EVIOCGABS(a.code), &info) < 0) {
+			ok = false;
+			continue;
+		}
+		info.fuzz = a.fuzz;
+		if (ioctl(fd, EVIOCSABS(a.code), &info) < 0) ok = false;
+	}
+	close(fd);
+	return ok;
+}
+
+// Raw frame handed from the acquisition thread to the processing thread.
+struct AcqFrame {
+	int64_t t_ns = 0; // CLOCK_MONOTONIC at acquisition
+	Xpt2046Frame f;
+	bool ok = false;
+	// Touch-down vote of the confirmation burst: -1 = none taken, 0 = rejected,
+	// 1 = confirmed (f is then the burst's last hit).
+	int8_t confirm = -1;
+};
+
+using AcqRing = SpscRing<AcqFrame, 256>;
+
+// What the acquisition thread needs to know. Written by the processing thread
+// (on config reload / touch state change), read lock-free by acquisition.
+struct AcqSettings {
+	std::atomic<int> poll_us{100000};
+	std::atomic<int> burst_xy{1};
+	std::atomic<int> burst_z{1};
+	std::atomic<int> burst_reduce{0};
+	std::atomic<int> press_threshold{120};
+	std::atomic<int> confirm_samples{4};
+	std::atomic<int> confirm_votes{3};
+	std::atomic<int> confirm_gap_us{300};
+	std::atomic<bool> touch_down{false};
+};
+
+static void publish_acq_settings(AcqSettings& s, const AdvancedParams& adv) {
+	s.poll_us.store(adv.poll_us, std::memory_order_relaxed);
+	s.burst_xy.store(adv.burst_xy, std::memory_order_relaxed);
+	s.burst_z.store(adv.burst_z, std::memory_order_relaxed);
+	s.burst_reduce.store(adv.burst_reduce, std::memory_order_relaxed);
+	s.press_threshold.store(adv.press_threshold, std::memory_order_relaxed);
+	s.confirm_samples.store(adv.confirm_samples, std::memory_order_relaxed);
+	s.confirm_votes.store(adv.confirm_votes, std::memory_order_relaxed);
+	s.confirm_gap_us.store(adv.confirm_gap_us, std::memory_order_relaxed);
+}
+
+
+// Touch the next chunk of stack so later calls never page-fault (with
+// mlockall(MCL_FUTURE) the pages then stay resident).
+static void prefault_stack() {
+	const size_t kPrefaultBytes = 64 * 1024;
+	unsigned char buf[kPrefaultBytes];
+	for (size_t i = 0; i < kPrefaultBytes; i += 4096) buf[i] = 0;
+	// Keep the stores: the compiler may not treat buf as dead.
+	asm volatile("" : : "r"(buf) : "memory");
+}
+
+static std::string set_fifo(pthread_t th, int prio) {
+	sched_param sp;
+	std::memset(&sp, 0, sizeof(sp));
+	sp.sched_priority = prio;
+	int err = pthread_setschedparam(th, SCHED_FIFO, &sp);
+	return err == 0 ? std::string("ok") : std::string(std::strerror(err));
+}
+
+// Process-wide part of the RT profile; must run before any thread is started
+// so their stacks fall under MCL_FUTURE.
+static void rt_lock_memory(std::string& mlock_res, std::string& malloc_res) {
+	mlock_res = (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) ? "ok" : std::strerror(errno);
+	// Never give heap back to the kernel and never serve malloc via mmap, so
+	// memory obtained during warm-up stays locked and reusable without faults.
+	bool ok = mallopt(M_TRIM_THRESHOLD, -1) == 1;
+	ok = (mallopt(M_MMAP_MAX, 0) == 1) && ok;
+	malloc_res = ok ? "ok" : "failed";
+	prefault_stack();
 }
 
-static void uinput_sync(int fd) {
-	uinput_emit(fd, EV_SYN, SYN_REPORT, 0);
+static std::string pin_thread(pthread_t th, int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	int err = pthread_setaffinity_np(th, sizeof(set), &set);
+	return err == 0 ? std::string("ok") : std::string(std::strerror(err));
 }
 
+// Acquisition stage: sample on a fixed cadence and hand timestamped raw frames
+// to the processing thread. Never touches config files or uinput, so stalls
+// there do not delay the next sample. Both the active and the idle rate are
+// paced by absolute deadlines.
+static bool pressure_hit(const Xpt2046Frame& f, int press_threshold) {
+	const int pressure = (f.z1 >= 0) ? f.z1 : 0;
+	return (press_threshold > 0) ? (pressure >= press_threshold) : (pressure > 0);
+}
+
+// An idle sample just crossed the press threshold: take confirm_samples more
+// reads confirm_gap_us apart and vote, instead of waiting a whole poll_us for
+// a second sample. A confirmed fr is replaced by the last hit, which is the
+// freshest position and taken with the finger pressed in further.
+static void confirm_touch(SpiTransport& spi, const AcqSettings& cfg, int press_threshold, int samples, AcqFrame& fr) {
+	const int votes = cfg.confirm_votes.load(std::memory_order_relaxed);
+	const int gap_us = cfg.confirm_gap_us.load(std::memory_order_relaxed);
+	const int burst_xy = cfg.burst_xy.load(std::memory_order_relaxed);
+	const int burst_z = cfg.burst_z.load(std::memory_order_relaxed);
+	const int burst_reduce = cfg.burst_reduce.load(std::memory_order_relaxed);
+
+	AcqFrame last_hit;
+	int hits = 0;
+	for (int i = 0; i < samples; ++i) {
+		if (gap_us > 0) {
+			timespec gap{0, (long)gap_us * 1000};
+			while (clock_nanosleep(CLOCK_MONOTONIC, 0, &gap, &gap) == EINTR) {}
+		}
+		AcqFrame s;
+		s.t_ns = monotonic_ns();
+		s.ok = read_xpt2046_burst(spi, burst_xy, burst_z, burst_reduce, s.f);
+		if (!s.ok || s.f.x < 0 || s.f.y < 0 || !pressure_hit(s.f, press_threshold)) continue;
+		last_hit = s;
+		hits++;
+		// Stop as soon as the outcome is decided either way.
+		if (hits >= votes || hits + (samples - 1 - i) < votes) break;
+	}
+	if (hits >= votes) {
+		fr = last_hit;
+		fr.confirm = 1;
+	} else {
+		fr.confirm = 0;
+	}
+}
+
+static void acquisition_loop(SpiTransport& spi,
+							 PenIrqSource* penirq,
+							 AcqSettings& cfg,
+							 AcqRing& ring,
+							 SchedStats& sched,
+							 int notify_fd) {
+	prefault_stack();
+
+	// Fast update while finger is down to keep UI responsive.
+	// Also switch to fast mode immediately when pressure suggests a touch (even before debounce)
+	// so the first movement is not delayed by a long idle poll.
+	const int active_poll_us = 5000; // 200 Hz when touching
+
+	// A burst confirmed the current contact. touch_down only rises once the
+	// processing thread has taken that frame, so without this the next
+	// samples would run the burst again. Cleared by the first sample below
+	// the press threshold.
+	bool contact_confirmed = false;
+
+	DeadlineTimer timer;
+	timer.rearm(monotonic_ns());
+	while (g_running) {
+		AllocFreeScope no_alloc;
+		AcqFrame fr;
+		fr.t_ns = monotonic_ns();
+		fr.ok = read_xpt2046_burst(spi,
+								   cfg.burst_xy.load(std::memory_order_relaxed),
+								   cfg.burst_z.load(std::memory_order_relaxed),
+								   cfg.burst_reduce.load(std::memory_order_relaxed),
+								   fr.f);
+
+		const int press_threshold = cfg.press_threshold.load(std::memory_order_relaxed);
+		const bool touch_down = cfg.touch_down.load(std::memory_order_relaxed);
+		bool pressure_touch = pressure_hit(fr.f, press_threshold);
+		const bool hit = pressure_touch && fr.ok && fr.f.x >= 0 && fr.f.y >= 0;
+		const int confirm_samples = cfg.confirm_samples.load(std::memory_order_relaxed);
+		if (!hit) {
+			contact_confirmed = false;
+		} else if (!touch_down && !contact_confirmed && confirm_samples > 0) {
+			confirm_touch(spi, cfg, press_threshold, confirm_samples, fr);
+			pressure_touch = fr.confirm > 0;
+			contact_confirmed = pressure_touch;
+		}
+
+		(void)ring.push(fr);
+		uint64_t one = 1;
+		(void)write(notify_fd, &one, sizeof(one));
+
+		switch (choose_idle_wait(touch_down || pressure_touch, penirq)) {
+		case IdleWait::Active:
+			timer.wait_next((int64_t)active_poll_us * 1000, sched);
+			break;
+		case IdleWait::PenIrq:
+			// Block on the pen interrupt instead of polling. The timeout only
+			// bounds how late a shutdown is noticed. Sampling restarts in a new
+			// phase right at the edge.
+			(void)penirq->wait_for_pen_down(1000);
+			timer.rearm(monotonic_ns());
+			break;
+		case IdleWait::Poll:
+			timer.wait_next((int64_t)cfg.poll_us.load(std::memory_order_relaxed) * 1000, sched);
+			break;
+		}
+	}
+}
+
+static void print_stats(std::ostream& os, const AcqRing& ring, const SchedStats& sched, const UinputBatch& uinput,
+						const TouchStateMachine& touch, uint64_t frames_processed) {
+	os << "[STATS] acquired=" << ring.pushed()
+	   << " processed=" << frames_processed
+	   << " ring_occupancy=" << ring.occupancy() << "/" << AcqRing::capacity()
+	   << " ring_high_water=" << ring.high_water()
+	   << " ring_overruns=" << ring.overruns()
+	   << " hot_path_allocs=" << alloc_violations()
+	   << std::endl;
+	os << "[STATS] uinput_frames=" << uinput.frames_written()
+	   << " uinput_events=" << uinput.events_written()
+	   << " suppressed_frames=" << uinput.frames_suppressed()
+	   << " write_errors=" << uinput.write_errors()
+	   << std::endl;
+	os << "[STATS] touch_confirmed=" << touch.confirmed()
+	   << " touch_rejected=" << touch.rejected()
+	   << " release_bounded=" << touch.bounded_releases()
+	   << " release_timeout=" << touch.timeout_releases()
+	   << std::endl;
+	char lag[96];
+	std::snprintf(lag, sizeof(lag), "mean=%.1f max=%lld", uinput.mean_lag_us(), (long long)uinput.max_lag_us());
+	os << "[STATS] acquisition_to_emit_us " << lag << std::endl;
+	if (sched.miss_threshold_us() > 0) {
+		os << "[STATS] deadline_misses=" << sched.missed()
+		   << " (late > " << sched.miss_threshold_us() << " us, plus skipped periods)" << std::endl;
+	}
+	char late[160];
+	std::snprintf(late, sizeof(late), "min=%lld mean=%.1f p99<=%lld max=%lld",
+				  (long long)sched.min_us(), sched.mean_us(), (long long)sched.p99_us(), (long long)sched.max_us());
+	os << "[STATS] wakeups=" << sched.count()
+	   << " lateness_us " << late
+	   << " skipped_periods=" << sched.skipped()
+	   << std::endl;
+}
+
+// Config loader thread. Waits for touch_config.txt changes as inotify events
+// on the candidate directories (stat() polling every kCfgPollNs without
+// inotify), compiles a snapshot and posts it; the processing thread installs
+// it at its next frame boundary. A reload runs kCfgSettleNs after the last
+// event, so writers that rewrite the file in several steps are read once
+// they are done.
+static void config_loop(SnapshotPublisher& publisher, std::string cfg_path) {
+	const int64_t kCfgSettleNs = 100000000LL;
+	const int64_t kCfgPollNs = 500000000LL;
+	ConfigWatch watch;
+	std::string watch_err;
+	const bool watched = watch.open(config_search_paths(), watch_err);
+	if (watched) {
+		std::cerr << "[INFO] Watching config: " << watch.describe() << std::endl;
+	} else {
+		std::cerr << "[WARN] Config watch unavailable (" << watch_err << "); polling every "
+				  << kCfgPollNs / 1000000 << " ms." << std::endl;
+	}
+
+	int64_t reload_due_ns = -1;
+	timespec cfg_mtime{0, 0};
+	(void)stat_mtime(cfg_path, cfg_mtime);
+	int64_t next_poll_ns = monotonic_ns() + kCfgPollNs;
+
+	while (g_running) {
+		// The timeout also bounds how late a shutdown is noticed.
+		int64_t timeout_ns = 500000000LL;
+		if (reload_due_ns >= 0) timeout_ns = std::max<int64_t>(0, std::min(timeout_ns, reload_due_ns - monotonic_ns()));
+		pollfd pfd{watch.fd(), POLLIN, 0}; // fd -1 (polling) only sleeps
+		if (poll(&pfd, 1, (int)((timeout_ns + 999999) / 1000000)) > 0 && watch.changed()) {
+			reload_due_ns = monotonic_ns() + kCfgSettleNs;
+		}
+
+		bool reload = false;
+		if (watched) {
+			if (reload_due_ns >= 0 && monotonic_ns() >= reload_due_ns) {
+				reload_due_ns = -1;
+				// Skip a change that left no config behind (deleted or moved away).
+				reload = !find_config_path().empty();
+			}
+		} else if (monotonic_ns() >= next_poll_ns) {
+			next_poll_ns = monotonic_ns() + kCfgPollNs;
+			timespec new_mtime{0, 0};
+			std::string newPath = find_config_path();
+			reload = !newPath.empty() && (newPath != cfg_path || (stat_mtime(newPath, new_mtime) && timespec_differs(new_mtime, cfg_mtime)));
+		}
+		if (!reload) continue;
+
+		std::unique_ptr<ConfigSnapshot> snap = load_config_snapshot();
+		cfg_path = snap->path;
+		(void)stat_mtime(cfg_path, cfg_mtime);
+		const AdvancedParams adv = snap->adv;
+		const char* chain = snap->fresh_chain->name();
+		const uint64_t generation = publisher.publish(std::move(snap));
+		std::cerr << "[INFO] Reloaded cfg=" << (cfg_path.empty() ? "<none>" : cfg_path)
+				  << " generation=" << generation
+				  << " poll_us=" << adv.poll_us
+				  << " iir_alpha=" << adv.iir_alpha
+				  << " euro=" << adv.euro_min_cutoff << "/" << adv.euro_beta << "/" << adv.euro_d_cutoff
+				  << " kalman_noise_px=" << adv.kalman_noise_px << " predict_ms=" << adv.predict_ms
+				  << " filters=" << chain
+				  << " median_window=" << adv.median_window
+				  << " burst=" << adv.burst_xy << "/" << adv.burst_z
+				  << " press_threshold=" << adv.press_threshold
+				  << " release_threshold=" << adv.release_threshold
+				  << std::endl;
+	}
+}
 
 int main() {
 	std::signal(SIGINT, handle_signal);
 	std::signal(SIGTERM, handle_signal);
+	std::signal(SIGUSR1, handle_stats_signal);
 
-	int invert_x = 0, invert_y = 0, swap_xy = 0;
-	int min_x = 0, max_x = 4095, min_y = 0, max_y = 4095;
-	AdvancedParams adv;
-	std::string cfgPath;
-	std::string spi_device_cfg;
-	load_config(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, cfgPath, spi_device_cfg);
-	apply_env_overrides(invert_x, invert_y, swap_xy, min_x, max_x, min_y, max_y, adv, spi_device_cfg);
-	sanitize_adv(adv);
+	// The processing thread reads the config only through cfg; reloads arrive
+	// as new snapshots. adv keeps the startup values for what is only applied
+	// once (devices, threads, RT profile).
+	std::unique_ptr<ConfigSnapshot> cfg = load_config_snapshot();
+	const AdvancedParams adv = cfg->adv;
+	const bool alloc_check = alloc_check_init();
 
 	std::string used_spi;
-	int spi_fd = open_spi_best(spi_device_cfg, used_spi);
-	if (spi_fd < 0) {
+	std::unique_ptr<SpiTransport> spi = open_spi_best(cfg->spi_device, used_spi);
+	if (!spi) {
 		std::cerr << "[ERROR] Failed to open any SPI device (spidev)." << std::endl;
 		return 1;
 	}
 
-	int ui_fd = uinput_create_touch(adv.screen_w, adv.screen_h);
+	std::string event_node;
+	int ui_fd = uinput_create_touch(adv, adv.abs_fuzz, event_node);
 	if (ui_fd < 0) {
-		close(spi_fd);
 		return 1;
 	}
 
-	std::cerr << "[INFO] xpt2046_uinputd started. cfg=" << (cfgPath.empty() ? "<none>" : cfgPath)
+	std::unique_ptr<PenIrqSource> penirq;
+	if (adv.penirq_line >= 0) {
+		std::string err;
+		penirq = open_gpio_penirq(adv.penirq_chip, adv.penirq_line, err);
+		if (!penirq) {
+			std::cerr << "[WARN] PENIRQ " << adv.penirq_chip << ":" << adv.penirq_line
+					  << " unavailable (" << err << "); falling back to poll_us polling." << std::endl;
+		}
+	}
+
+	// Filter chain specialized for the current settings; reconfigured or
+	// replaced when a new snapshot is installed.
+	std::unique_ptr<FilterChain> filters = std::move(cfg->fresh_chain);
+
+	std::cerr << "[INFO] xpt2046_uinputd started. cfg=" << (cfg->path.empty() ? "<none>" : cfg->path)
 			  << " spi=" << used_spi
 			  << " screen=" << adv.screen_w << "x" << adv.screen_h
 			  << " poll_us=" << adv.poll_us
 			  << " active_poll_us=" << 5000
+			  << " burst=" << adv.burst_xy << "/" << adv.burst_z
+			  << " mapping=" << (adv.affine.empty() ? "minmax" : "affine") << (adv.mesh.empty() ? "" : "+mesh")
+			  << " filters=" << filters->name()
+			  << " penirq=" << (penirq ? penirq->describe() : std::string("off"))
+			  << " acq_cpu=" << adv.acq_cpu
+			  << " confirm=" << adv.confirm_votes << "/" << adv.confirm_samples << "@" << adv.confirm_gap_us << "us"
+			  << " abs_fuzz=" << (adv.abs_fuzz < 0 ? std::string("auto") : std::to_string(adv.abs_fuzz))
+			  << " rt_priority=" << adv.rt_priority
+			  << " alloc_check=" << (alloc_check ? 1 : 0)
 			  << std::endl;
 
-	timespec cfg_mtime{0, 0};
-	(void)stat_mtime(cfgPath, cfg_mtime);
-	auto next_cfg_check = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
-
-	bool touch_down = false;
 	int32_t tracking_id = 1;
-	int press_streak = 0;
-	int release_streak = 0;
-	int candidate_x = 0;
-	int candidate_y = 0;
-	bool have_candidate = false;
-	bool have_filtered = false;
-	int filt_x = 0;
-	int filt_y = 0;
-	std::deque<int> hist_x;
-	std::deque<int> hist_y;
-
-	auto median_of = [](std::deque<int> v) -> int {
-		if (v.empty()) return 0;
-		std::sort(v.begin(), v.end());
-		return v[v.size() / 2];
-	};
+	TouchStateMachine touch;
+	touch.configure(adv.press_threshold, adv.release_threshold, adv.release_max_ms, adv.release_timeout_ms);
+
+	AcqSettings acq_cfg;
+	publish_acq_settings(acq_cfg, adv);
+	AcqRing ring;
+	SchedStats sched;
+	sched.set_miss_threshold_us(adv.deadline_miss_us);
+
+	std::string rt_mlock = "off", rt_malloc = "off";
+	if (adv.rt_priority > 0) rt_lock_memory(rt_mlock, rt_malloc);
+
+	int notify_fd = eventfd(0, EFD_CLOEXEC);
+	if (notify_fd < 0) {
+		std::perror("eventfd");
+		ioctl(ui_fd, UI_DEV_DESTROY);
+		close(ui_fd);
+		return 1;
+	}
+	std::thread acq_thread(acquisition_loop, std::ref(*spi), penirq.get(), std::ref(acq_cfg), std::ref(ring), std::ref(sched), notify_fd);
+	// Started before the processing thread turns SCHED_FIFO, so they keep the
+	// default policy.
+	SnapshotMailbox cfg_mailbox;
+	SnapshotPublisher cfg_publisher(cfg_mailbox, notify_fd, *cfg);
+	std::thread cfg_thread(config_loop, std::ref(cfg_publisher), cfg->path);
+	ControlServer ctl(cfg_publisher, notify_fd);
+	if (!adv.ctl_socket.empty()) {
+		std::string err;
+		if (ctl.open(adv.ctl_socket, err)) {
+			ctl.start();
+			std::cerr << "[INFO] Control socket: " << adv.ctl_socket << std::endl;
+		} else {
+			std::cerr << "[WARN] Control socket unavailable (" << err << ")." << std::endl;
+		}
+	}
+	FeedWriter feed;
+	if (!adv.feed_shm.empty()) {
+		std::string err;
+		if (feed.open(adv.feed_shm, err)) {
+			std::cerr << "[INFO] Sample feed: " << adv.feed_shm << std::endl;
+		} else {
+			std::cerr << "[WARN] Sample feed unavailable (" << err << ")." << std::endl;
+		}
+	}
 
-	while (g_running) {
-		// Auto-reload config when touch_config.txt changes. We only reload while idle
-		// to avoid mid-gesture jumps.
-		const auto now = std::chrono::steady_clock::now();
-		if (now >= next_cfg_check) {
-			next_cfg_check = now + std::chrono::milliseconds(500);
-			if (!touch_down) {
-				// Only attempt reload while not touching; pressure_touch is known only after we read Z.
-				timespec new_mtime{0, 0};
-				std::string newPath = find_config_path();
-				if (!newPath.empty() && (newPath != cfgPath || (stat_mtime(newPath, new_mtime) && timespec_differs(new_mtime, cfg_mtime)))) {
-					int new_invert_x = 0, new_invert_y = 0, new_swap_xy = 0;
-					int new_min_x = 0, new_max_x = 4095, new_min_y = 0, new_max_y = 4095;
-					AdvancedParams new_adv;
-					std::string usedPath;
-					std::string new_spi_device_cfg;
-					load_config(new_invert_x, new_invert_y, new_swap_xy, new_min_x, new_max_x, new_min_y, new_max_y, new_adv, usedPath, new_spi_device_cfg);
-					apply_env_overrides(new_invert_x, new_invert_y, new_swap_xy, new_min_x, new_max_x, new_min_y, new_max_y, new_adv, new_spi_device_cfg);
-					sanitize_adv(new_adv);
-
-					invert_x = new_invert_x;
-					invert_y = new_invert_y;
-					swap_xy = new_swap_xy;
-					min_x = new_min_x;
-					max_x = new_max_x;
-					min_y = new_min_y;
-					max_y = new_max_y;
-					adv = new_adv;
-					cfgPath = usedPath;
-					spi_device_cfg = new_spi_device_cfg;
-
-					(void)stat_mtime(cfgPath, cfg_mtime);
-
-					// Reset filters so new config takes effect cleanly.
-					press_streak = 0;
-					release_streak = 0;
-					have_filtered = false;
-					hist_x.clear();
-					hist_y.clear();
-					have_candidate = false;
-
-					std::cerr << "[INFO] Reloaded cfg=" << (cfgPath.empty() ? "<none>" : cfgPath)
-							  << " poll_us=" << adv.poll_us
-							  << " iir_alpha=" << adv.iir_alpha
-							  << " median_window=" << adv.median_window
-							  << " press_threshold=" << adv.press_threshold
-							  << " release_threshold=" << adv.release_threshold
-							  << std::endl;
-				}
-			}
+	std::string rt_pin = "off", rt_fifo = "off";
+	if (adv.acq_cpu >= 0) rt_pin = pin_thread(acq_thread.native_handle(), adv.acq_cpu);
+	if (adv.rt_priority > 0) {
+		rt_fifo = set_fifo(acq_thread.native_handle(), adv.rt_priority);
+		const std::string proc_fifo = set_fifo(pthread_self(), std::max(1, adv.rt_priority - 1));
+		if (proc_fifo != "ok") rt_fifo += " (processing: " + proc_fifo + ")";
+	}
+	if (adv.rt_priority > 0 || adv.acq_cpu >= 0) {
+		auto got = [](const std::string& r) { return r == "ok" || r == "off"; };
+		const bool all_ok = got(rt_fifo) && got(rt_mlock) && got(rt_malloc) && got(rt_pin);
+		std::cerr << (all_ok ? "[INFO]" : "[WARN]")
+				  << " RT profile: sched_fifo=" << rt_fifo
+				  << " prio=" << adv.rt_priority
+				  << " mlockall=" << rt_mlock
+				  << " malloc_locked=" << rt_malloc
+				  << " prefault=" << (adv.rt_priority > 0 ? "ok" : "off")
+				  << " acq_cpu=" << adv.acq_cpu << ":" << rt_pin
+				  << std::endl;
+	}
+
+	// Touch was reported to uinput and not yet released.
+	bool contact_open = false;
+	// One write() per frame; unchanged axes and empty frames are skipped.
+	UinputBatch uinput;
+	PressureHysteresis pressure_band;
+	// abs_fuzz=-1: measure the output noise at rest, then set the fuzz once.
+	StationaryNoise noise;
+	bool fuzz_pending = adv.abs_fuzz < 0;
+	uint64_t frames_processed = 0;
+	// Frames before the allocation check starts enforcing (first-use
+	// allocations inside libc/libstdc++ are allowed until then).
+	const uint64_t kAllocWarmupFrames = 200;
+	// Without XPT_ALLOC_CHECK the scope only counts; new counts are logged
+	// at most this often so a regression shows up without asking for stats.
+	const int64_t kAllocWarnIntervalNs = 10000000000LL;
+	uint64_t allocs_reported = 0;
+	int64_t alloc_warn_ns = 0;
+
+	// Type-B MT: slot + tracking ID + position first, then the keys.
+	auto emit_contact = [&](int64_t t_ns, int x, int y, int pressure, bool new_contact) {
+		uinput.timestamp(t_ns);
+		if (new_contact) {
+			// New contact: send every axis, not only those that moved.
+			uinput.invalidate();
+			pressure_band.reset();
+			uinput.abs(ABS_MT_SLOT, 0);
+			uinput.add(EV_ABS, ABS_MT_TRACKING_ID, tracking_id++);
 		}
+		uinput.abs(ABS_MT_POSITION_X, x);
+		uinput.abs(ABS_MT_POSITION_Y, y);
+		uinput.abs(ABS_MT_PRESSURE, pressure_band.update(pressure));
 
-		// Fast update while finger is down to keep UI responsive.
-		// Also switch to fast mode immediately when pressure suggests a touch (even before debounce)
-		// so the first movement is not delayed by a long idle poll.
-		const int active_poll_us = 5000; // 200 Hz when touching
+		// Also publish single-touch ABS for compatibility.
+		uinput.abs(ABS_X, x);
+		uinput.abs(ABS_Y, y);
 
-		int raw_x = read_xpt2046(spi_fd, 0x90);
-		int raw_y = read_xpt2046(spi_fd, 0xD0);
-		int z1 = read_xpt2046(spi_fd, 0xB0);
-		int pressure = (z1 >= 0) ? z1 : 0;
+		if (new_contact) {
+			uinput.add(EV_KEY, BTN_TOUCH, 1);
+			uinput.add(EV_KEY, BTN_TOOL_FINGER, 1);
+		}
+		uinput.submit(ui_fd);
+	};
 
-		const bool pressure_touch = (adv.press_threshold > 0) ? (pressure >= adv.press_threshold) : (pressure > 0);
-		const int sleep_us = (touch_down || pressure_touch) ? active_poll_us : adv.poll_us;
-		if (raw_x < 0 || raw_y < 0) {
-			usleep((useconds_t)sleep_us);
-			continue;
+	// Written in the same frame as the release decision, never deferred.
+	auto emit_release = [&](int64_t t_ns) {
+		filters->reset();
+		acq_cfg.touch_down.store(false, std::memory_order_relaxed);
+		if (!contact_open) return;
+		contact_open = false;
+		uinput.timestamp(t_ns);
+		uinput.abs(ABS_MT_SLOT, 0);
+		uinput.add(EV_ABS, ABS_MT_TRACKING_ID, -1);
+		uinput.add(EV_KEY, BTN_TOUCH, 0);
+		uinput.add(EV_KEY, BTN_TOOL_FINGER, 0);
+		uinput.submit(ui_fd);
+	};
+
+	// tap receives the mapping stages and the emitted position for control
+	// socket subscribers and the sample feed.
+	auto process_frame = [&](const AcqFrame& fr, CtlSample& tap) {
+		const int pressure = (fr.f.z1 >= 0) ? fr.f.z1 : 0;
+		const bool valid = fr.ok && fr.f.x >= 0 && fr.f.y >= 0;
+		int sx = 0;
+		int sy = 0;
+		if (valid) {
+			cfg->mapper.axes(fr.f.x, fr.f.y, tap.axis_x, tap.axis_y);
+			cfg->mapper.map(fr.f.x, fr.f.y, sx, sy);
+			tap.screen_x = sx;
+			tap.screen_y = sy;
 		}
 
-		// While not touching, do NOT update filters from floating/noise samples.
-		// Otherwise the filtered state drifts to a corner and the first real touch "travels" from there.
-		if (!touch_down && !pressure_touch) {
-			press_streak = 0;
-			release_streak = 0;
-			have_filtered = false;
-			hist_x.clear();
-			hist_y.clear();
-			have_candidate = false;
-			usleep((useconds_t)sleep_us);
-			continue;
+		const TouchEvent ev = touch.update(fr.t_ns, valid, pressure, fr.confirm);
+		if (ev == TouchEvent::Release) {
+			emit_release(fr.t_ns);
+			return;
+		}
+		if (ev == TouchEvent::Press) {
+			// Reset filters so the first reported position snaps to the finger.
+			filters->reset();
+			acq_cfg.touch_down.store(true, std::memory_order_relaxed);
 		}
 
-		int x = raw_x;
-		int y = raw_y;
-		if (swap_xy) std::swap(x, y);
-		if (invert_x) x = 4095 - x;
-		if (invert_y) y = 4095 - y;
-		x = clamp_val(x, min_x, max_x);
-		y = clamp_val(y, min_y, max_y);
-
-		int sx = (x - min_x) * (adv.screen_w - 1) / std::max(1, (max_x - min_x));
-		int sy = (y - min_y) * (adv.screen_h - 1) / std::max(1, (max_y - min_y));
-		sx = clamp_val(sx, 0, adv.screen_w - 1);
-		sy = clamp_val(sy, 0, adv.screen_h - 1);
-
-		sx = (int)std::llround(sx * adv.scale_x + adv.offset_x);
-		sy = (int)std::llround(sy * adv.scale_y + adv.offset_y);
-
-		int min_sx = clamp_val(adv.deadzone_left, 0, adv.screen_w - 1);
-		int max_sx = clamp_val(adv.screen_w - 1 - adv.deadzone_right, 0, adv.screen_w - 1);
-		int min_sy = clamp_val(adv.deadzone_top, 0, adv.screen_h - 1);
-		int max_sy = clamp_val(adv.screen_h - 1 - adv.deadzone_bottom, 0, adv.screen_h - 1);
-		if (max_sx < min_sx) max_sx = min_sx;
-		if (max_sy < min_sy) max_sy = min_sy;
-		sx = clamp_val(sx, min_sx, max_sx);
-		sy = clamp_val(sy, min_sy, max_sy);
-
-		// Remember the raw mapped position for instant touch-down.
-		candidate_x = sx;
-		candidate_y = sy;
-		have_candidate = true;
-
-		// Touch state with hysteresis + debounce (prevents rapid DOWN/UP chatter)
-		if (adv.press_threshold > 0) {
-			if (!touch_down) {
-				if (pressure >= adv.press_threshold) {
-					press_streak++;
-					if (press_streak >= 2) {
-						touch_down = true;
-						// Reset filters so first reported position snaps to finger.
-						have_filtered = false;
-						hist_x.clear();
-						hist_y.clear();
-						if (have_candidate) {
-							filt_x = candidate_x;
-							filt_y = candidate_y;
-							have_filtered = true;
-						}
-						release_streak = 0;
-					}
-				} else {
-					press_streak = 0;
-				}
-			} else {
-				press_streak = 0;
-				if (pressure <= adv.release_threshold) {
-					release_streak++;
-					if (release_streak >= 2) {
-						touch_down = false;
-						have_filtered = false;
-						hist_x.clear();
-						hist_y.clear();
-						have_candidate = false;
-						release_streak = 0;
-					}
-				} else {
-					release_streak = 0;
-				}
-			}
-		} else {
-			// No thresholds: fallback to simple pressure heuristic but still debounce.
-			if (!touch_down) {
-				if (pressure > 0) {
-					press_streak++;
-					if (press_streak >= 2) {
-						touch_down = true;
-						have_filtered = false;
-						hist_x.clear();
-						hist_y.clear();
-						if (have_candidate) {
-							filt_x = candidate_x;
-							filt_y = candidate_y;
-							have_filtered = true;
-						}
-						release_streak = 0;
-					}
-				} else {
-					press_streak = 0;
-				}
-			} else {
-				press_streak = 0;
-				if (pressure <= 0) {
-					release_streak++;
-					if (release_streak >= 2) {
-						touch_down = false;
-						have_filtered = false;
-						hist_x.clear();
-						hist_y.clear();
-						have_candidate = false;
-						release_streak = 0;
-					}
-				} else {
-					release_streak = 0;
-				}
-			}
+		// Only Down samples reach the filters. Idle ones are floating noise
+		// (the filtered state would drift to a corner and the first real touch
+		// "travel" from there), Releasing ones are taken while the finger lifts.
+		if (touch.state() != TouchState::Down) {
+			if (!touch.down()) filters->reset();
+			return;
 		}
 
-		// If we're still debouncing (pressure detected but not yet touch_down), don't run filters.
-		if (!touch_down) {
-			usleep((useconds_t)sleep_us);
-			continue;
+		FilterSample fs;
+		fs.x = sx;
+		fs.y = sy;
+		fs.t_ns = fr.t_ns;
+		fs.pressed = (cfg->adv.press_threshold > 0) ? (pressure >= cfg->adv.press_threshold) : (pressure > 0);
+		filters->process(fs);
+		const int out_x = fs.x;
+		const int out_y = fs.y;
+		if (fuzz_pending) {
+			if (!contact_open) noise.restart_window();
+			noise.add(out_x, out_y);
 		}
 
-		int out_x = sx;
-		int out_y = sy;
-
-		// Clamp step (max_delta_px)
-		if (adv.max_delta_px > 0 && have_filtered) {
-			int dx = out_x - filt_x;
-			int dy = out_y - filt_y;
-			if (dx > adv.max_delta_px) out_x = filt_x + adv.max_delta_px;
-			else if (dx < -adv.max_delta_px) out_x = filt_x - adv.max_delta_px;
-			if (dy > adv.max_delta_px) out_y = filt_y + adv.max_delta_px;
-			else if (dy < -adv.max_delta_px) out_y = filt_y - adv.max_delta_px;
+		emit_contact(fr.t_ns, out_x, out_y, pressure, !contact_open);
+		contact_open = true;
+		tap.x = out_x;
+		tap.y = out_y;
+	};
+
+	// Swap in a snapshot from the loader between two frames. The running
+	// filter chain keeps its state when the new parameters map to the same
+	// chain, so a reload during a touch does not restart the smoothing.
+	auto install_config = [&](std::unique_ptr<ConfigSnapshot> next) {
+		const AdvancedParams& a = next->adv;
+		const bool kept = std::strcmp(filters->name(), next->fresh_chain->name()) == 0;
+		if (kept) {
+			filters->reconfigure(next->filters);
+		} else {
+			filters = std::move(next->fresh_chain);
+		}
+		touch.configure(a.press_threshold, a.release_threshold, a.release_max_ms, a.release_timeout_ms);
+		publish_acq_settings(acq_cfg, a);
+		sched.set_miss_threshold_us(a.deadline_miss_us);
+		// Different filters leave different residual noise.
+		noise.reset();
+		fuzz_pending = a.abs_fuzz < 0;
+		if (a.abs_fuzz >= 0) (void)uinput_set_fuzz(event_node, a.abs_fuzz, a.abs_fuzz);
+		if (a.screen_w != adv.screen_w || a.screen_h != adv.screen_h || a.penirq_line != adv.penirq_line ||
+			a.penirq_chip != adv.penirq_chip || a.rt_priority != adv.rt_priority || a.acq_cpu != adv.acq_cpu ||
+			a.panel_width_mm != adv.panel_width_mm || a.panel_height_mm != adv.panel_height_mm) {
+			std::cerr << "[WARN] screen size, panel size, PENIRQ, rt_priority and acq_cpu changes take effect on restart."
+					  << std::endl;
 		}
+		std::cerr << "[INFO] Applied config generation " << next->generation
+				  << (touch.down() ? " during a touch" : "")
+				  << " filters=" << filters->name() << (kept ? " (state kept)" : " (rebuilt)")
+				  << std::endl;
+		// The previous snapshot is released here, outside any frame.
+		cfg = std::move(next);
+	};
 
-		// Median filter
-		if (adv.median_window == 3 || adv.median_window == 5) {
-			int mw = adv.median_window;
-			hist_x.push_back(out_x);
-			hist_y.push_back(out_y);
-			while ((int)hist_x.size() > mw) hist_x.pop_front();
-			while ((int)hist_y.size() > mw) hist_y.pop_front();
-			out_x = median_of(hist_x);
-			out_y = median_of(hist_y);
+	while (g_running) {
+		// Sleep until the acquisition thread has queued frames or the loader
+		// posted a config. The timeout keeps shutdown checks going while nobody
+		// touches the panel, and while a contact is open it ends at the touch
+		// release deadline.
+		int64_t timeout_ns = 500000000LL;
+		const int64_t deadline = touch.next_deadline_ns();
+		if (deadline >= 0) timeout_ns = std::max<int64_t>(0, std::min(timeout_ns, deadline - monotonic_ns()));
+		const timespec timeout{(time_t)(timeout_ns / 1000000000LL), (long)(timeout_ns % 1000000000LL)};
+		pollfd pfd{notify_fd, POLLIN, 0};
+		if (ppoll(&pfd, 1, &timeout, nullptr) > 0) {
+			uint64_t cnt = 0;
+			(void)read(notify_fd, &cnt, sizeof(cnt));
 		}
 
-		// IIR smoothing
-		if (adv.iir_alpha > 0.0f) {
-			if (!have_filtered) {
-				filt_x = out_x;
-				filt_y = out_y;
-				have_filtered = true;
-			} else {
-				float a = adv.iir_alpha;
-				filt_x = (int)std::llround((1.0f - a) * (float)filt_x + a * (float)out_x);
-				filt_y = (int)std::llround((1.0f - a) * (float)filt_y + a * (float)out_y);
+		if (std::unique_ptr<ConfigSnapshot> next = cfg_mailbox.take()) install_config(std::move(next));
+
+		{
+			AllocFreeScope no_alloc;
+			AcqFrame fr;
+			while (ring.pop(fr)) {
+				CtlSample tap;
+				process_frame(fr, tap);
+				tap.t_ns = fr.t_ns;
+				tap.raw_x = fr.f.x;
+				tap.raw_y = fr.f.y;
+				tap.z1 = fr.f.z1;
+				tap.z2 = fr.f.z2;
+				tap.state = (uint8_t)touch.state();
+				tap.down = touch.down() ? 1 : 0;
+				if (ctl.has_subscribers()) ctl.push_sample(tap);
+				if (feed.is_open()) feed.publish(feed_frame(tap));
+				if (++frames_processed == kAllocWarmupFrames) alloc_check_arm();
 			}
-			out_x = filt_x;
-			out_y = filt_y;
-		} else {
-			filt_x = out_x;
-			filt_y = out_y;
-			have_filtered = true;
+			const int64_t now_ns = monotonic_ns();
+			if (touch.tick(now_ns) == TouchEvent::Release) emit_release(now_ns);
 		}
 
-		static bool last_down = false;
-		if (touch_down) {
-			// Type-B MT: set slot + tracking + position first, then key.
-			uinput_emit(ui_fd, EV_ABS, ABS_MT_SLOT, 0);
-			if (!last_down) {
-				uinput_emit(ui_fd, EV_ABS, ABS_MT_TRACKING_ID, tracking_id++);
+		const uint64_t hot_allocs = alloc_violations();
+		if (hot_allocs != allocs_reported) {
+			const int64_t now_ns = monotonic_ns();
+			if (allocs_reported == 0 || now_ns - alloc_warn_ns >= kAllocWarnIntervalNs) {
+				std::cerr << "[WARN] " << hot_allocs - allocs_reported
+						  << " heap allocation(s) in the per-sample path after warm-up (hot_path_allocs="
+						  << hot_allocs << ")" << std::endl;
+				allocs_reported = hot_allocs;
+				alloc_warn_ns = now_ns;
 			}
-			uinput_emit(ui_fd, EV_ABS, ABS_MT_POSITION_X, out_x);
-			uinput_emit(ui_fd, EV_ABS, ABS_MT_POSITION_Y, out_y);
-			uinput_emit(ui_fd, EV_ABS, ABS_MT_PRESSURE, pressure);
-
-			// Also publish single-touch ABS for compatibility.
-			uinput_emit(ui_fd, EV_ABS, ABS_X, out_x);
-			uinput_emit(ui_fd, EV_ABS, ABS_Y, out_y);
+		}
 
-			if (!last_down) {
-				uinput_emit(ui_fd, EV_KEY, BTN_TOUCH, 1);
-				uinput_emit(ui_fd, EV_KEY, BTN_TOOL_FINGER, 1);
-			}
-			uinput_sync(ui_fd);
-		} else {
-			if (last_down) {
-				// End touch contact
-				uinput_emit(ui_fd, EV_ABS, ABS_MT_SLOT, 0);
-				uinput_emit(ui_fd, EV_ABS, ABS_MT_TRACKING_ID, -1);
-				uinput_emit(ui_fd, EV_KEY, BTN_TOUCH, 0);
-				uinput_emit(ui_fd, EV_KEY, BTN_TOOL_FINGER, 0);
-				uinput_sync(ui_fd);
-			}
+		if (fuzz_pending && noise.ready()) {
+			fuzz_pending = false;
+			const int fx = StationaryNoise::fuzz_for(noise.std_x());
+			const int fy = StationaryNoise::fuzz_for(noise.std_y());
+			const bool ok = uinput_set_fuzz(event_node, fx, fy);
+			char msg[160];
+			std::snprintf(msg, sizeof(msg), "noise at rest %.2f/%.2f px -> fuzz %d/%d", noise.std_x(), noise.std_y(), fx, fy);
+			std::cerr << (ok ? "[INFO] ABS " : "[WARN] Could not set ABS ") << msg << std::endl;
 		}
-		last_down = touch_down;
 
-		usleep((useconds_t)sleep_us);
+		if (g_dump_stats.exchange(false)) print_stats(std::cerr, ring, sched, uinput, touch, frames_processed);
+		if (ctl.stats_requested()) {
+			std::ostringstream os;
+			print_stats(os, ring, sched, uinput, touch, frames_processed);
+			ctl.post_stats(os.str());
+		}
 	}
 
+	acq_thread.join();
+	cfg_thread.join();
+	ctl.stop();
+	close(notify_fd);
+	// Do not leave a pressed contact behind for whoever reads the device last.
+	if (touch.down()) emit_release(monotonic_ns());
+	print_stats(std::cerr, ring, sched, uinput, touch, frames_processed);
 	ioctl(ui_fd, UI_DEV_DESTROY);
 	close(ui_fd);
-	close(spi_fd);
+	spi.reset();
 	std::cerr << "[INFO] xpt2046_uinputd exiting." << std::endl;
 	return 0;
 }
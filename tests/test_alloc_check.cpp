@@ -0,0 +1,124 @@
+// AllocFreeScope accounting, and the per-sample path (burst read, mapping,
+// filter chains) staying allocation-free once warmed up.
+
+#include "xpt2046_alloc_check.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "xpt2046_config.h"
+#include "xpt2046_mapping.h"
+#include "xpt2046_pipeline.h"
+#include "xpt2046_transport.h"
+
+#include "test_util.h"
+
+namespace {
+
+// Called through a volatile pointer so the compiler cannot elide the pair.
+void* volatile g_sink = nullptr;
+
+void allocate_once() {
+	g_sink = ::operator new(32);
+	::operator delete(g_sink);
+}
+
+void test_counts_before_arming() {
+	const uint64_t before = alloc_count();
+	allocate_once();
+	CHECK_EQ(alloc_count() - before, 1);
+	{
+		AllocFreeScope scope;
+		allocate_once();
+	}
+	CHECK_EQ(alloc_violations(), 0); // not armed yet
+}
+
+// Run once armed: only allocations inside a scope, on the same thread,
+// are violations.
+void test_violations_after_arming() {
+	alloc_check_arm();
+	// Started outside the scope: creating a thread allocates.
+	std::atomic<int> step{0};
+	std::thread other([&step] {
+		while (step.load() != 1) std::this_thread::yield();
+		allocate_once();
+		step.store(2);
+	});
+
+	const uint64_t v0 = alloc_violations();
+	allocate_once();
+	CHECK_EQ(alloc_violations(), v0);
+	{
+		AllocFreeScope scope;
+		allocate_once();
+		CHECK_EQ(alloc_violations(), v0 + 1);
+		{
+			AllocFreeScope nested;
+			allocate_once();
+		}
+		CHECK_EQ(alloc_violations(), v0 + 2);
+		// The scope is per thread.
+		step.store(1);
+		while (step.load() != 2) std::this_thread::yield();
+		CHECK_EQ(alloc_violations(), v0 + 2);
+	}
+	other.join();
+	allocate_once();
+	CHECK_EQ(alloc_violations(), v0 + 2);
+}
+
+// One sample through everything the daemon runs per frame, for each kind
+// of filter chain; after a warm-up pass nothing may allocate.
+void test_hot_path_allocation_free() {
+	SimParams sp;
+	sp.step_us = 2000;
+	SimTransport sim(sp);
+	AdvancedParams variants[4];
+	variants[1].euro_min_cutoff = 1.0f;
+	variants[2].kalman_noise_px = 2.0f;
+	variants[2].predict_ms = 8;
+	variants[3].median_window = 0;
+	variants[3].iir_alpha = 0.0f;
+	variants[3].affine = "0.19,0,-10,0,0.11,-5";
+
+	for (AdvancedParams& adv : variants) {
+		sanitize_adv(adv);
+		ScreenMapper mapper;
+		mapper.build(mapping_params(0, 0, 0, 0, 4095, 0, 4095, adv));
+		std::unique_ptr<FilterChain> chain = make_filter_chain(filter_params(adv));
+		const uint64_t v0 = alloc_violations();
+		const uint64_t a0 = alloc_count();
+		int64_t t_ns = 0;
+		for (int pass = 0; pass < 2; ++pass) {
+			for (int i = 0; i < 500; ++i) {
+				AllocFreeScope scope;
+				Xpt2046Frame f;
+				read_xpt2046_burst(sim, 3, 2, 0, f);
+				FilterSample s;
+				mapper.map(f.x, f.y, s.x, s.y);
+				s.t_ns = (t_ns += 2000000);
+				s.pressed = f.z1 > 100;
+				chain->process(s);
+			}
+			chain->reset();
+		}
+		CHECK_EQ(alloc_violations(), v0);
+		CHECK_EQ(alloc_count(), a0);
+	}
+}
+
+} // namespace
+
+int main() {
+	// Count violations instead of aborting on them.
+	unsetenv("XPT_ALLOC_CHECK");
+	CHECK(!alloc_check_init());
+	test_counts_before_arming();
+	test_violations_after_arming();
+	test_hot_path_allocation_free();
+	return test_result("alloc_check");
+}
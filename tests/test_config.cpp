@@ -0,0 +1,75 @@
+// update_config_keys: symlinked configs, file mode and the replace/append.
+
+#include "xpt2046_config.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_util.h"
+
+namespace {
+
+std::string read_file(const std::string& path) {
+	std::ifstream in(path);
+	std::stringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+void write_file(const std::string& path, const std::string& data) {
+	std::ofstream out(path, std::ios::trunc);
+	out << data;
+}
+
+void test_replace_and_append(const std::string& dir) {
+	const std::string cfg = dir + "/plain.txt";
+	write_file(cfg, "# comment\nspi_device=/dev/spidev0.0\nswap_xy=0\n");
+	CHECK(chmod(cfg.c_str(), 0600) == 0);
+	CHECK(update_config_keys(cfg, {{"swap_xy", "1"}, {"affine", "1,0,0,0,1,0"}}));
+	CHECK(read_file(cfg) == "# comment\nspi_device=/dev/spidev0.0\nswap_xy=1\naffine=1,0,0,0,1,0\n");
+	struct stat st;
+	CHECK(stat(cfg.c_str(), &st) == 0);
+	CHECK_EQ(st.st_mode & 07777, 0600);
+	CHECK(access((cfg + ".tmp").c_str(), F_OK) != 0);
+}
+
+// The link stays a link and its target gets the new contents.
+void test_symlink_kept(const std::string& dir) {
+	const std::string target = dir + "/target.txt";
+	const std::string link = dir + "/link.txt";
+	write_file(target, "swap_xy=0\n");
+	CHECK(chmod(target.c_str(), 0640) == 0);
+	CHECK(symlink(target.c_str(), link.c_str()) == 0);
+	CHECK(update_config_key(link, "swap_xy", "1"));
+	struct stat st;
+	CHECK(lstat(link.c_str(), &st) == 0);
+	CHECK(S_ISLNK(st.st_mode));
+	CHECK(read_file(target) == "swap_xy=1\n");
+	CHECK(stat(target.c_str(), &st) == 0);
+	CHECK_EQ(st.st_mode & 07777, 0640);
+}
+
+void test_new_file(const std::string& dir) {
+	const std::string cfg = dir + "/new.txt";
+	CHECK(update_config_key(cfg, "invert_x", "1"));
+	CHECK(read_file(cfg) == "invert_x=1\n");
+}
+
+} // namespace
+
+int main() {
+	char tmpl[] = "/tmp/xpt2046_test_config.XXXXXX";
+	const char* dir = mkdtemp(tmpl);
+	CHECK(dir != nullptr);
+	if (!dir) return test_result("config");
+	test_replace_and_append(dir);
+	test_symlink_kept(dir);
+	test_new_file(dir);
+	const std::string cleanup = std::string("rm -rf ") + dir;
+	if (std::system(cleanup.c_str()) != 0) std::fprintf(stderr, "could not remove %s\n", dir);
+	return test_result("config");
+}
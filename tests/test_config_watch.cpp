@@ -0,0 +1,92 @@
+// ConfigWatch with a symlinked config: saves land next to the link target,
+// and retargeting the link moves the watch.
+
+#include "xpt2046_config_watch.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "xpt2046_config.h"
+
+#include "test_util.h"
+
+namespace {
+
+void write_file(const std::string& path, const std::string& data) {
+	std::ofstream out(path, std::ios::trunc);
+	out << data;
+}
+
+// Replace the link atomically, as `ln -sfn` followed by a rename would.
+void relink(const std::string& target, const std::string& link) {
+	const std::string tmp = link + ".new";
+	unlink(tmp.c_str());
+	CHECK(symlink(target.c_str(), tmp.c_str()) == 0);
+	CHECK(std::rename(tmp.c_str(), link.c_str()) == 0);
+}
+
+void test_symlinked_config(const std::string& root) {
+	const std::string data = root + "/data";
+	const std::string etc = root + "/etc";
+	CHECK(mkdir(data.c_str(), 0755) == 0);
+	CHECK(mkdir(etc.c_str(), 0755) == 0);
+	const std::string first = data + "/first.txt";
+	const std::string second = data + "/second.txt";
+	const std::string link = etc + "/touch_config.txt";
+	write_file(first, "swap_xy=0\n");
+	write_file(second, "swap_xy=0\n");
+	CHECK(symlink(first.c_str(), link.c_str()) == 0);
+
+	ConfigWatch watch;
+	std::string err;
+	CHECK(watch.open({link}, err));
+	CHECK(!watch.changed());
+
+	// The save renames a sibling over data/first.txt; nothing happens in etc/.
+	CHECK(update_config_key(link, "swap_xy", "1"));
+	CHECK(watch.changed());
+	CHECK(!watch.changed());
+
+	// Unrelated files next to the target do not count.
+	write_file(data + "/other.txt", "x\n");
+	CHECK(!watch.changed());
+
+	// Retargeting the link is a change, and the watch follows it.
+	relink(second, link);
+	CHECK(watch.changed());
+	CHECK(update_config_key(link, "invert_x", "1"));
+	CHECK(watch.changed());
+	write_file(first, "swap_xy=0\n");
+	CHECK(!watch.changed());
+}
+
+void test_plain_config(const std::string& root) {
+	const std::string dir = root + "/plain";
+	CHECK(mkdir(dir.c_str(), 0755) == 0);
+	const std::string cfg = dir + "/touch_config.txt";
+	ConfigWatch watch;
+	std::string err;
+	CHECK(watch.open({cfg}, err));
+	// A config that appears later is picked up.
+	CHECK(update_config_key(cfg, "swap_xy", "1"));
+	CHECK(watch.changed());
+	CHECK(watch.describe() == "inotify:" + dir);
+}
+
+} // namespace
+
+int main() {
+	char tmpl[] = "/tmp/xpt2046_test_config_watch.XXXXXX";
+	const char* root = mkdtemp(tmpl);
+	CHECK(root != nullptr);
+	if (!root) return test_result("config_watch");
+	test_symlinked_config(root);
+	test_plain_config(root);
+	const std::string cleanup = std::string("rm -rf ") + root;
+	if (std::system(cleanup.c_str()) != 0) std::fprintf(stderr, "could not remove %s\n", root);
+	return test_result("config_watch");
+}
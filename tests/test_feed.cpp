@@ -0,0 +1,167 @@
+// Sample feed: one writer per path, symlinks refused, readers follow a
+// writer restart, daemon frames carry every stage.
+
+#include "xpt2046_ctl.h"
+#include "xpt2046_feed.h"
+#include "xpt2046_mapping.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "test_util.h"
+
+namespace {
+
+FeedFrame frame(int x) {
+	FeedFrame f;
+	f.raw_x = x;
+	f.down = 1;
+	return f;
+}
+
+void test_publish_read(const std::string& path) {
+	std::string err;
+	FeedWriter w;
+	CHECK(w.open(path, err));
+	FeedReader r;
+	CHECK(r.open(path));
+	FeedFrame f;
+	CHECK(!r.latest(f));
+	for (int i = 0; i < 3; ++i) w.publish(frame(100 + i));
+	FeedFrame got[8];
+	CHECK_EQ(r.read_new(got, 8), 3);
+	CHECK_EQ(got[0].raw_x, 100);
+	CHECK_EQ(got[2].raw_x, 102);
+	CHECK(r.latest(f));
+	CHECK_EQ(f.raw_x, 102);
+}
+
+// A daemon and a hand-run calibrator on the same feed_shm: the second
+// writer is refused instead of interleaving frames with the first.
+void test_second_writer_fails(const std::string& path) {
+	std::string err;
+	FeedWriter a;
+	CHECK(a.open(path, err));
+	FeedWriter b;
+	CHECK(!b.open(path, err));
+	CHECK(err.find("another writer") != std::string::npos);
+	a.close();
+	CHECK(b.open(path, err));
+}
+
+void test_symlink_refused(const std::string& dir) {
+	const std::string target = dir + "/victim";
+	const std::string link = dir + "/feed-link";
+	const int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+	CHECK(fd >= 0);
+	if (fd >= 0) close(fd);
+	CHECK(symlink(target.c_str(), link.c_str()) == 0);
+	std::string err;
+	FeedWriter w;
+	CHECK(!w.open(link, err));
+	struct stat st;
+	CHECK(stat(target.c_str(), &st) == 0);
+	CHECK_EQ(st.st_size, 0); // the link target was left alone
+	FeedReader r;
+	CHECK(!r.open(link));
+	unlink(link.c_str());
+	unlink(target.c_str());
+}
+
+// A reader attached to a writer that went away closes and picks up the
+// next writer's segment.
+void test_reader_follows_restart(const std::string& path) {
+	std::string err;
+	FeedReader r;
+	{
+		FeedWriter w;
+		CHECK(w.open(path, err));
+		CHECK(r.open(path));
+		w.publish(frame(1));
+	}
+	FeedFrame f;
+	CHECK(!r.latest(f));
+	CHECK(!r.is_open());
+	FeedWriter w;
+	CHECK(w.open(path, err));
+	CHECK(r.open(path));
+	w.publish(frame(2));
+	CHECK(r.latest(f));
+	CHECK_EQ(f.raw_x, 2);
+}
+
+// The daemon publishes feed_frame() of its processing tap: raw, the
+// swapped/inverted axes, the mapped position and the filtered output.
+void test_daemon_frame_stages(const std::string& path) {
+	MappingParams p;
+	p.swap_xy = 1;
+	p.invert_x = 1;
+	p.min_x = 200;
+	p.max_x = 3900;
+	p.screen_w = 800;
+	p.screen_h = 480;
+	ScreenMapper mapper;
+	mapper.build(p);
+
+	CtlSample tap;
+	tap.t_ns = 42;
+	tap.raw_x = 1000;
+	tap.raw_y = 3000;
+	tap.z1 = 600;
+	tap.z2 = 900;
+	mapper.axes(tap.raw_x, tap.raw_y, tap.axis_x, tap.axis_y);
+	mapper.map(tap.raw_x, tap.raw_y, tap.screen_x, tap.screen_y);
+	tap.x = tap.screen_x + 1;
+	tap.y = tap.screen_y - 1;
+	tap.down = 1;
+	tap.state = 2;
+	CHECK_EQ(tap.axis_x, 4095 - 3000);
+	CHECK_EQ(tap.axis_y, 1000);
+	int sx = 0, sy = 0;
+	map_raw_to_screen(p, tap.raw_x, tap.raw_y, sx, sy);
+	CHECK_EQ(tap.screen_x, sx);
+	CHECK_EQ(tap.screen_y, sy);
+
+	std::string err;
+	FeedWriter w;
+	CHECK(w.open(path, err));
+	FeedReader r;
+	CHECK(r.open(path));
+	w.publish(feed_frame(tap));
+	FeedFrame f;
+	CHECK(r.latest(f));
+	CHECK_EQ(f.t_ns, 42);
+	CHECK_EQ(f.raw_x, 1000);
+	CHECK_EQ(f.raw_y, 3000);
+	CHECK_EQ(f.z2, 900);
+	CHECK_EQ(f.pressure, 600);
+	CHECK_EQ(f.axis_x, tap.axis_x);
+	CHECK_EQ(f.axis_y, tap.axis_y);
+	CHECK_EQ(f.screen_x, sx);
+	CHECK_EQ(f.screen_y, sy);
+	CHECK_EQ(f.out_x, sx + 1);
+	CHECK_EQ(f.out_y, sy - 1);
+	CHECK_EQ(f.down, 1);
+	CHECK_EQ(f.state, 2);
+}
+
+} // namespace
+
+int main() {
+	char tmpl[] = "/tmp/xpt2046_test_feed.XXXXXX";
+	const char* dir = mkdtemp(tmpl);
+	CHECK(dir != nullptr);
+	if (!dir) return test_result("feed");
+	const std::string path = std::string(dir) + "/feed";
+	test_publish_read(path);
+	test_second_writer_fails(path);
+	test_symlink_refused(dir);
+	test_reader_follows_restart(path);
+	test_daemon_frame_stages(path);
+	unlink(path.c_str());
+	rmdir(dir);
+	return test_result("feed");
+}
@@ -0,0 +1,74 @@
+// Affine calibration fits: degenerate targets are refused and a clean fit
+// recovers the transform.
+
+#include "xpt2046_mapping.h"
+
+#include <cmath>
+
+#include "test_util.h"
+
+namespace {
+
+CalPoint target(double raw_x, double raw_y, const double m[6]) {
+	CalPoint p;
+	p.raw_x = raw_x;
+	p.raw_y = raw_y;
+	p.screen_x = m[0] * raw_x + m[1] * raw_y + m[2];
+	p.screen_y = m[3] * raw_x + m[4] * raw_y + m[5];
+	return p;
+}
+
+const double kPanel[6] = {0.19, 0.004, -30.0, -0.003, 0.115, -20.0};
+
+// Nine targets in a grid with a little tap noise fit to within a pixel.
+void test_fit_recovers_transform() {
+	std::vector<CalPoint> pts;
+	const double noise[9] = {1.5, -2.0, 0.5, -1.0, 2.0, -0.5, 1.0, -1.5, 0.0};
+	int k = 0;
+	for (int j = 0; j < 3; ++j) {
+		for (int i = 0; i < 3; ++i, ++k) {
+			pts.push_back(target(300 + i * 1700, 400 + j * 1600, kPanel));
+			pts.back().raw_x += noise[k];
+			pts.back().raw_y -= noise[k];
+		}
+	}
+	double m[6], rms = 0.0, worst = 0.0;
+	CHECK(solve_affine(pts, m, rms, worst));
+	for (int i = 0; i < 6; ++i) CHECK(std::fabs(m[i] - kPanel[i]) < (i % 3 == 2 ? 2.0 : 0.002));
+	CHECK(worst < 1.0);
+	CHECK(worst <= kMaxAffineResidualPx);
+}
+
+// Touches within a few thousandths of a raw unit of one line: the smallest
+// pivot is tiny next to the raw-squared entries but well above 1e-9.
+void test_nearly_collinear_rejected() {
+	std::vector<CalPoint> pts;
+	for (int i = 0; i < 9; ++i) {
+		const double x = 137.0 + i * 471.3;
+		pts.push_back(target(x, x / 3.0 + 211.7 + (i % 2 ? 0.003 : -0.003), kPanel));
+	}
+	double m[6], rms = 0.0, worst = 0.0;
+	CHECK(!solve_affine(pts, m, rms, worst));
+}
+
+// One target tapped far from where it was drawn still solves, but the worst
+// residual is over the limit the calibrator saves with.
+void test_missed_tap_over_limit() {
+	std::vector<CalPoint> pts;
+	for (int j = 0; j < 3; ++j) {
+		for (int i = 0; i < 3; ++i) pts.push_back(target(300 + i * 1700, 400 + j * 1600, kPanel));
+	}
+	pts[4].raw_x += 400; // ~76 px off at 0.19 px per raw unit
+	double m[6], rms = 0.0, worst = 0.0;
+	CHECK(solve_affine(pts, m, rms, worst));
+	CHECK(worst > kMaxAffineResidualPx);
+}
+
+} // namespace
+
+int main() {
+	test_fit_recovers_transform();
+	test_nearly_collinear_rejected();
+	test_missed_tap_over_limit();
+	return test_result("mapping");
+}
@@ -0,0 +1,73 @@
+// Idle wait of the acquisition thread, driven through FakePenIrq.
+
+#include "xpt2046_penirq.h"
+
+#include <chrono>
+#include <thread>
+
+#include "test_util.h"
+
+namespace {
+
+int64_t elapsed_ms(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Without PENIRQ the loop polls while idle.
+void test_without_penirq() {
+	CHECK(choose_idle_wait(true, nullptr) == IdleWait::Active);
+	CHECK(choose_idle_wait(false, nullptr) == IdleWait::Poll);
+}
+
+// Line high and no contact: block on the interrupt, which times out or
+// returns on the injected falling edge.
+void test_blocks_while_high() {
+	FakePenIrq irq;
+	CHECK(choose_idle_wait(false, &irq) == IdleWait::PenIrq);
+
+	auto t0 = std::chrono::steady_clock::now();
+	CHECK_EQ(irq.wait_for_pen_down(30), 0);
+	CHECK(elapsed_ms(t0) >= 25);
+
+	std::thread edge([&irq] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		irq.inject(true);
+	});
+	t0 = std::chrono::steady_clock::now();
+	CHECK_EQ(irq.wait_for_pen_down(2000), 1);
+	CHECK(elapsed_ms(t0) < 1000);
+	edge.join();
+	CHECK(choose_idle_wait(true, &irq) == IdleWait::Active);
+}
+
+// A touch below press_threshold (or rejected by the confirmation burst)
+// holds the line low without a contact. wait_for_pen_down() would return at
+// once, so the loop must fall back to the poll_us timer until the line has
+// gone high again.
+void test_low_without_press_polls() {
+	FakePenIrq irq;
+	irq.inject(true);
+	CHECK_EQ(irq.wait_for_pen_down(0), 1); // why blocking would spin
+
+	int blocked = 0;
+	for (int i = 0; i < 100; ++i) {
+		if (choose_idle_wait(false, &irq) == IdleWait::PenIrq) blocked++;
+	}
+	CHECK_EQ(blocked, 0);
+	CHECK(choose_idle_wait(false, &irq) == IdleWait::Poll);
+
+	irq.inject(false);
+	CHECK(choose_idle_wait(false, &irq) == IdleWait::PenIrq);
+	auto t0 = std::chrono::steady_clock::now();
+	CHECK_EQ(irq.wait_for_pen_down(30), 0);
+	CHECK(elapsed_ms(t0) >= 25);
+}
+
+} // namespace
+
+int main() {
+	test_without_penirq();
+	test_blocks_while_high();
+	test_low_without_press_polls();
+	return test_result("penirq");
+}
@@ -0,0 +1,72 @@
+// Filter chains keep extrapolated positions inside the deadzones.
+
+#include "xpt2046_pipeline.h"
+
+#include "test_util.h"
+
+namespace {
+
+FilterParams predicting_params() {
+	FilterParams p;
+	p.screen_w = 800;
+	p.screen_h = 480;
+	p.deadzone_left = 15;
+	p.deadzone_right = 20;
+	p.deadzone_top = 10;
+	p.deadzone_bottom = 25;
+	p.kalman_noise_px = 2.0f;
+	p.predict_ms = 30;
+	p.predict_max_px = 60;
+	return p;
+}
+
+// Drag at speed into one corner and stop at the deadzone edge, the way the
+// mapper delivers it; prediction must not carry the output past it.
+void check_drag(int from_x, int from_y, int to_x, int to_y, int lo_x, int hi_x, int lo_y, int hi_y) {
+	std::unique_ptr<FilterChain> chain = make_filter_chain(predicting_params());
+	int64_t t_ns = 0;
+	bool reached = false;
+	for (int i = 0; i <= 60; ++i) {
+		FilterSample s;
+		s.x = from_x + (to_x - from_x) * i / 40;
+		s.y = from_y + (to_y - from_y) * i / 40;
+		s.x = std::min(std::max(s.x, lo_x), hi_x);
+		s.y = std::min(std::max(s.y, lo_y), hi_y);
+		s.t_ns = (t_ns += 5000000);
+		chain->process(s);
+		CHECK(s.x >= lo_x && s.x <= hi_x);
+		CHECK(s.y >= lo_y && s.y <= hi_y);
+		if (s.x == hi_x || s.x == lo_x) reached = true;
+	}
+	CHECK(reached);
+}
+
+void test_prediction_respects_deadzones() {
+	// Usable area: x 15..779, y 10..454.
+	check_drag(400, 240, 900, 600, 15, 779, 10, 454);
+	check_drag(400, 240, -100, -100, 15, 779, 10, 454);
+}
+
+// Without deadzones the screen edges still bound the output.
+void test_prediction_respects_screen() {
+	FilterParams p = predicting_params();
+	p.deadzone_left = p.deadzone_right = p.deadzone_top = p.deadzone_bottom = 0;
+	std::unique_ptr<FilterChain> chain = make_filter_chain(p);
+	int64_t t_ns = 0;
+	for (int i = 0; i <= 40; ++i) {
+		FilterSample s;
+		s.x = std::min(799, 400 + i * 20);
+		s.y = 240;
+		s.t_ns = (t_ns += 5000000);
+		chain->process(s);
+		CHECK(s.x >= 0 && s.x <= 799);
+	}
+}
+
+} // namespace
+
+int main() {
+	test_prediction_respects_deadzones();
+	test_prediction_respects_screen();
+	return test_result("pipeline");
+}
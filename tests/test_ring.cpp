@@ -0,0 +1,135 @@
+// SpscRing (the acquisition -> processing queue): wraparound, overruns when
+// full, the high-water mark, and a two-thread run with the daemon's
+// eventfd handoff.
+
+#include "xpt2046_ring.h"
+
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+#include "test_util.h"
+
+namespace {
+
+struct Item {
+	uint64_t seq = 0;
+	int64_t t_ns = 0;
+};
+
+using Ring = SpscRing<Item, 256>;
+
+void test_wraparound() {
+	Ring ring;
+	uint64_t next_in = 0;
+	uint64_t next_out = 0;
+	// Uneven batches walk the indices across the 256 boundary several times.
+	const int batches[] = {200, 256, 1, 255, 129, 256};
+	for (int n : batches) {
+		for (int i = 0; i < n; ++i) {
+			Item it;
+			it.seq = next_in++;
+			CHECK(ring.push(it));
+		}
+		CHECK_EQ(ring.occupancy(), n);
+		Item out;
+		while (ring.pop(out)) CHECK_EQ(out.seq, next_out++);
+	}
+	CHECK_EQ(next_out, next_in);
+	CHECK_EQ(ring.pushed(), next_in);
+	CHECK_EQ(ring.overruns(), 0);
+}
+
+void test_full_counts_overrun() {
+	Ring ring;
+	Item it;
+	for (size_t i = 0; i < Ring::capacity(); ++i) {
+		it.seq = i;
+		CHECK(ring.push(it));
+	}
+	it.seq = 999;
+	CHECK(!ring.push(it));
+	CHECK(!ring.push(it));
+	CHECK_EQ(ring.overruns(), 2);
+	CHECK_EQ(ring.occupancy(), 256);
+	// The dropped items never appear; the oldest one is still first.
+	Item out;
+	CHECK(ring.pop(out));
+	CHECK_EQ(out.seq, 0);
+	it.seq = 256;
+	CHECK(ring.push(it));
+	CHECK_EQ(ring.overruns(), 2);
+	uint64_t expect = 1;
+	while (ring.pop(out)) CHECK_EQ(out.seq, expect++);
+	CHECK_EQ(expect, 257);
+}
+
+void test_high_water() {
+	Ring ring;
+	Item it, out;
+	CHECK_EQ(ring.high_water(), 0);
+	for (int i = 0; i < 10; ++i) CHECK(ring.push(it));
+	while (ring.pop(out)) {
+	}
+	CHECK_EQ(ring.high_water(), 10);
+	for (int i = 0; i < 5; ++i) CHECK(ring.push(it));
+	CHECK_EQ(ring.high_water(), 10); // a lower peak does not lower it
+	for (int i = 0; i < 300; ++i) (void)ring.push(it);
+	CHECK_EQ(ring.high_water(), 256);
+}
+
+// Producer and consumer as in the daemon: push, then signal the eventfd;
+// the consumer sleeps in poll() and drains. The producer retries a full
+// ring here so every item must arrive, in order.
+void test_two_threads() {
+	Ring ring;
+	const int efd = eventfd(0, EFD_CLOEXEC);
+	CHECK(efd >= 0);
+	if (efd < 0) return;
+	const uint64_t kItems = 200000;
+
+	std::thread producer([&] {
+		for (uint64_t i = 0; i < kItems; ++i) {
+			Item it;
+			it.seq = i;
+			it.t_ns = (int64_t)i * 3;
+			while (!ring.push(it)) std::this_thread::yield();
+			if ((i & 15) == 15 || i + 1 == kItems) {
+				const uint64_t one = 1;
+				(void)write(efd, &one, sizeof(one));
+			}
+		}
+	});
+
+	uint64_t expect = 0;
+	bool in_order = true;
+	while (expect < kItems) {
+		pollfd pfd{efd, POLLIN, 0};
+		if (poll(&pfd, 1, 1000) <= 0) break; // a lost wakeup fails below
+		uint64_t cnt = 0;
+		(void)read(efd, &cnt, sizeof(cnt));
+		Item out;
+		while (ring.pop(out)) {
+			if (out.seq != expect || out.t_ns != (int64_t)expect * 3) in_order = false;
+			++expect;
+		}
+	}
+	producer.join();
+	close(efd);
+	CHECK(in_order);
+	CHECK_EQ(expect, kItems);
+	CHECK_EQ(ring.pushed(), kItems);
+	CHECK(ring.high_water() <= Ring::capacity());
+}
+
+} // namespace
+
+int main() {
+	test_wraparound();
+	test_full_counts_overrun();
+	test_high_water();
+	test_two_threads();
+	return test_result("ring");
+}
@@ -0,0 +1,158 @@
+// TouchStateMachine driven by synthetic pressure sequences.
+
+#include "xpt2046_touch_state.h"
+
+#include "test_util.h"
+
+namespace {
+
+const int64_t kMs = 1000000LL;
+const int kPress = 120;
+const int kRelease = 80;
+const int kReleaseMaxMs = 15;
+const int kReleaseTimeoutMs = 100;
+
+TouchStateMachine make_machine() {
+	TouchStateMachine m;
+	m.configure(kPress, kRelease, kReleaseMaxMs, kReleaseTimeoutMs);
+	return m;
+}
+
+// Idle -> Confirming -> Down -> Releasing -> Idle on pressure alone.
+void test_full_cycle() {
+	TouchStateMachine m = make_machine();
+	CHECK(m.state() == TouchState::Idle);
+	CHECK(m.next_deadline_ns() == -1);
+
+	CHECK(m.update(0, true, 50) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Idle);
+	CHECK(m.update(5 * kMs, true, 200) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Confirming);
+	CHECK(!m.down());
+	CHECK(m.update(10 * kMs, true, 210) == TouchEvent::Press);
+	CHECK(m.state() == TouchState::Down);
+	CHECK(m.down());
+	// Between the thresholds: still down (hysteresis).
+	CHECK(m.update(15 * kMs, true, 100) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Down);
+	CHECK(m.update(20 * kMs, true, 60) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Releasing);
+	CHECK(m.down());
+	CHECK(m.update(25 * kMs, true, 40) == TouchEvent::Release);
+	CHECK(m.state() == TouchState::Idle);
+	CHECK(!m.down());
+}
+
+// A single hit followed by a miss is noise, not a touch.
+void test_confirming_drops_back() {
+	TouchStateMachine m = make_machine();
+	CHECK(m.update(0, true, 200) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Confirming);
+	CHECK(m.update(5 * kMs, true, 30) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Idle);
+}
+
+// The acquisition thread's burst vote decides at once.
+void test_burst_vote() {
+	TouchStateMachine m = make_machine();
+	CHECK(m.update(0, true, 200, 0) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Idle);
+	CHECK_EQ(m.rejected(), 1);
+	CHECK(m.update(5 * kMs, true, 200, 1) == TouchEvent::Press);
+	CHECK(m.state() == TouchState::Down);
+	CHECK_EQ(m.confirmed(), 1);
+}
+
+// One low sample during a touch does not lift the finger.
+void test_pressure_dip() {
+	TouchStateMachine m = make_machine();
+	m.update(0, true, 200, 1);
+	CHECK(m.update(5 * kMs, true, 50) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Releasing);
+	CHECK(m.update(10 * kMs, true, 200) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Down);
+}
+
+// No second low sample: tick() reports the release exactly release_max
+// after the first one.
+void test_release_max_bound() {
+	TouchStateMachine m = make_machine();
+	m.update(0, true, 200, 1);
+	const int64_t t_low = 7 * kMs;
+	m.update(t_low, true, 10);
+	CHECK(m.state() == TouchState::Releasing);
+	CHECK_EQ(m.next_deadline_ns(), t_low + kReleaseMaxMs * kMs);
+	CHECK(m.tick(t_low + kReleaseMaxMs * kMs - 1) == TouchEvent::None);
+	CHECK(m.down());
+	CHECK(m.tick(t_low + kReleaseMaxMs * kMs) == TouchEvent::Release);
+	CHECK(m.state() == TouchState::Idle);
+	CHECK_EQ(m.bounded_releases(), 1);
+	CHECK_EQ(m.timeout_releases(), 0);
+	CHECK(m.next_deadline_ns() == -1);
+}
+
+// A failed read counts as low, so failing reads end the touch within
+// release_max as well.
+void test_failed_reads_release() {
+	TouchStateMachine m = make_machine();
+	m.update(0, true, 200, 1);
+	CHECK(m.update(5 * kMs, false, 0) == TouchEvent::None);
+	CHECK(m.state() == TouchState::Releasing);
+	CHECK(m.update(10 * kMs, false, 0) == TouchEvent::Release);
+	CHECK(!m.down());
+
+	m.update(20 * kMs, true, 200, 1);
+	m.update(25 * kMs, false, 0);
+	CHECK(m.tick(25 * kMs + kReleaseMaxMs * kMs) == TouchEvent::Release);
+	CHECK_EQ(m.bounded_releases(), 1);
+}
+
+// Samples stop arriving while down: release_timeout after the last good one.
+void test_release_timeout() {
+	TouchStateMachine m = make_machine();
+	m.update(0, true, 200, 1);
+	const int64_t t_last = 30 * kMs;
+	m.update(t_last, true, 220);
+	CHECK(m.state() == TouchState::Down);
+	CHECK_EQ(m.next_deadline_ns(), t_last + kReleaseTimeoutMs * kMs);
+	CHECK(m.tick(t_last + kReleaseTimeoutMs * kMs - 1) == TouchEvent::None);
+	CHECK(m.tick(t_last + kReleaseTimeoutMs * kMs) == TouchEvent::Release);
+	CHECK(m.state() == TouchState::Idle);
+	CHECK_EQ(m.timeout_releases(), 1);
+	CHECK_EQ(m.bounded_releases(), 0);
+}
+
+// Releasing: the earlier of the two deadlines applies.
+void test_deadline_is_earliest() {
+	TouchStateMachine m = make_machine();
+	m.update(0, true, 200, 1);
+	m.update(95 * kMs, true, 10);
+	CHECK_EQ(m.next_deadline_ns(), (int64_t)kReleaseTimeoutMs * kMs);
+	CHECK(m.tick(kReleaseTimeoutMs * kMs) == TouchEvent::Release);
+	CHECK_EQ(m.timeout_releases(), 1);
+}
+
+// press_threshold <= 0: any pressure presses, none releases.
+void test_threshold_disabled() {
+	TouchStateMachine m;
+	m.configure(0, 0, kReleaseMaxMs, kReleaseTimeoutMs);
+	CHECK(m.update(0, true, 1) == TouchEvent::None);
+	CHECK(m.update(5 * kMs, true, 1) == TouchEvent::Press);
+	CHECK(m.update(10 * kMs, true, 0) == TouchEvent::None);
+	CHECK(m.update(15 * kMs, true, 0) == TouchEvent::Release);
+}
+
+} // namespace
+
+int main() {
+	test_full_cycle();
+	test_confirming_drops_back();
+	test_burst_vote();
+	test_pressure_dip();
+	test_release_max_bound();
+	test_failed_reads_release();
+	test_release_timeout();
+	test_deadline_is_earliest();
+	test_threshold_disabled();
+	return test_result("touch_state");
+}
@@ -0,0 +1,149 @@
+// Overlapped XPT2046 command encoding and burst reduction, against a fake
+// chip that answers each command with a scripted value.
+
+#include "xpt2046_transport.h"
+
+#include <vector>
+
+#include "test_util.h"
+
+namespace {
+
+// Answers every command byte (start bit set) the way the chip does: one busy
+// clock, then the 12-bit result MSB first over the next two bytes.
+class ScriptedChip : public SpiTransport {
+public:
+	explicit ScriptedChip(std::vector<int> values) : values_(std::move(values)) {}
+
+	bool transfer(const uint8_t* tx, uint8_t* rx, size_t len) override {
+		last_tx.assign(tx, tx + len);
+		for (size_t i = 0; i < len; ++i) rx[i] = 0;
+		for (size_t i = 0; i + 2 < len; ++i) {
+			if (!(tx[i] & 0x80)) continue;
+			const int v = next_ < values_.size() ? values_[next_++] : 0;
+			rx[i + 1] = (uint8_t)((v >> 5) & 0x7F);
+			rx[i + 2] = (uint8_t)((v << 3) & 0xF8);
+		}
+		return !fail;
+	}
+	std::string name() const override { return "scripted"; }
+
+	std::vector<uint8_t> last_tx;
+	bool fail = false;
+
+private:
+	std::vector<int> values_;
+	size_t next_ = 0;
+};
+
+// One conversion per axis: X, Y, Z1, Z2 commands two bytes apart in a
+// 2*4+1 byte message, results decoded to the right fields.
+void test_single_frame_encoding() {
+	ScriptedChip chip({1234, 3210, 600, 3500});
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_frame(chip, f));
+	CHECK_EQ(chip.last_tx.size(), 9);
+	const uint8_t expect[9] = {0x90, 0, 0xD0, 0, 0xB0, 0, 0xC0, 0, 0};
+	for (size_t i = 0; i < 9 && i < chip.last_tx.size(); ++i) CHECK_EQ(chip.last_tx[i], expect[i]);
+	CHECK_EQ(f.x, 1234);
+	CHECK_EQ(f.y, 3210);
+	CHECK_EQ(f.z1, 600);
+	CHECK_EQ(f.z2, 3500);
+}
+
+// Full-scale values survive the 7+5 bit split.
+void test_extremes() {
+	ScriptedChip chip({0, 4095, 1, 4094});
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_frame(chip, f));
+	CHECK_EQ(f.x, 0);
+	CHECK_EQ(f.y, 4095);
+	CHECK_EQ(f.z1, 1);
+	CHECK_EQ(f.z2, 4094);
+}
+
+// Oversampled burst: n_xy commands per axis, then n_z, in one message of
+// 2*N+1 bytes; the median drops a single spike per axis.
+void test_burst_median() {
+	ScriptedChip chip({1000, 4095, 1002,   // X
+					   2000, 0, 2001,      // Y
+					   500, 510,           // Z1
+					   3000, 3010});       // Z2
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_burst(chip, 3, 2, 0, f));
+	CHECK_EQ(chip.last_tx.size(), 2 * 10 + 1);
+	const uint8_t cmds[10] = {0x90, 0x90, 0x90, 0xD0, 0xD0, 0xD0, 0xB0, 0xB0, 0xC0, 0xC0};
+	for (size_t k = 0; k < 10 && 2 * k + 1 < chip.last_tx.size(); ++k) {
+		CHECK_EQ(chip.last_tx[2 * k], cmds[k]);
+		CHECK_EQ(chip.last_tx[2 * k + 1], 0);
+	}
+	CHECK_EQ(f.x, 1002);
+	CHECK_EQ(f.y, 2000);
+	CHECK_EQ(f.z1, 510); // upper median of an even count
+	CHECK_EQ(f.z2, 3010);
+}
+
+// Trimmed mean: the lowest and highest quarter are dropped before
+// averaging.
+void test_burst_trimmed_mean() {
+	ScriptedChip chip({0, 100, 102, 104, 106, 108, 110, 4095, // X: mean of 100..110
+					   200, 200, 200, 200, 200, 200, 200, 200, // Y
+					   700,                                    // Z1
+					   3000});                                 // Z2
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_burst(chip, 8, 1, 1, f));
+	CHECK_EQ(f.x, (100 + 102 + 104 + 106 + 108 + 110) / 6);
+	CHECK_EQ(f.y, 200);
+	CHECK_EQ(f.z1, 700);
+	CHECK_EQ(f.z2, 3000);
+}
+
+// Burst sizes are clamped to 1..16 per axis.
+void test_burst_clamp() {
+	std::vector<int> vals(64, 321);
+	ScriptedChip chip(vals);
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_burst(chip, 40, 0, 0, f));
+	CHECK_EQ(chip.last_tx.size(), 2 * (16 + 16 + 1 + 1) + 1);
+	CHECK_EQ(f.x, 321);
+}
+
+// A failed transfer leaves an invalid frame.
+void test_failed_transfer() {
+	ScriptedChip chip({1, 2, 3, 4});
+	chip.fail = true;
+	Xpt2046Frame f;
+	f.x = 5;
+	CHECK(!read_xpt2046_frame(chip, f));
+	CHECK_EQ(f.x, -1);
+	CHECK_EQ(f.z1, -1);
+}
+
+// The replay backend answers through the same encoding.
+void test_replay_roundtrip() {
+	ReplaySample s;
+	s.x = 1500;
+	s.y = 2500;
+	s.z1 = 450;
+	s.z2 = 3600;
+	ReplayTransport replay({s}, "test");
+	Xpt2046Frame f;
+	CHECK(read_xpt2046_burst(replay, 4, 2, 0, f));
+	CHECK_EQ(f.x, 1500);
+	CHECK_EQ(f.y, 2500);
+	CHECK_EQ(f.z1, 450);
+	CHECK_EQ(f.z2, 3600);
+}
+
+} // namespace
+
+int main() {
+	test_single_frame_encoding();
+	test_extremes();
+	test_burst_median();
+	test_burst_trimmed_mean();
+	test_burst_clamp();
+	test_failed_transfer();
+	test_replay_roundtrip();
+	return test_result("transport");
+}
@@ -0,0 +1,54 @@
+// UinputBatch duplicate suppression with a jittering pressure.
+
+#include "xpt2046_uinput.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "test_util.h"
+
+namespace {
+
+void test_hysteresis() {
+	PressureHysteresis band;
+	CHECK_EQ(band.update(600), 600);
+	CHECK_EQ(band.update(603), 600);
+	CHECK_EQ(band.update(600 - PressureHysteresis::kStep + 1), 600);
+	CHECK_EQ(band.update(600 + PressureHysteresis::kStep), 600 + PressureHysteresis::kStep);
+	band.reset();
+	CHECK_EQ(band.update(300), 300);
+}
+
+// A resting finger: position steady, Z1 jittering by a few counts. Every
+// frame after the first is a duplicate and must not be written.
+void test_resting_finger_suppressed() {
+	const int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+	CHECK(fd >= 0);
+	UinputBatch batch;
+	PressureHysteresis band;
+	const int jitter[] = {0, 3, -2, 5, -4, 1, -6, 2};
+	for (int i = 0; i < 64; ++i) {
+		batch.abs(ABS_MT_POSITION_X, 400);
+		batch.abs(ABS_MT_POSITION_Y, 240);
+		batch.abs(ABS_MT_PRESSURE, band.update(600 + jitter[i % 8]));
+		batch.submit(fd);
+	}
+	CHECK_EQ(batch.frames_written(), 1);
+	CHECK_EQ(batch.frames_suppressed(), 63);
+
+	// A real pressure change still goes out.
+	batch.abs(ABS_MT_POSITION_X, 400);
+	batch.abs(ABS_MT_POSITION_Y, 240);
+	batch.abs(ABS_MT_PRESSURE, band.update(700));
+	CHECK(batch.submit(fd));
+	CHECK_EQ(batch.frames_written(), 2);
+	close(fd);
+}
+
+} // namespace
+
+int main() {
+	test_hysteresis();
+	test_resting_finger_suppressed();
+	return test_result("uinput");
+}
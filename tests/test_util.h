@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the unit tests: a failed check is reported with its
+// location and counted, and main() returns test_result().
+
+static int g_test_failures = 0;
+
+#define CHECK(cond)                                                                    \
+	do {                                                                               \
+		if (!(cond)) {                                                                 \
+			std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			++g_test_failures;                                                         \
+		}                                                                              \
+	} while (0)
+
+#define CHECK_EQ(a, b)                                                                    \
+	do {                                                                                  \
+		const long long va_ = (long long)(a);                                             \
+		const long long vb_ = (long long)(b);                                             \
+		if (va_ != vb_) {                                                                 \
+			std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, \
+						 __LINE__, #a, #b, va_, vb_);                                     \
+			++g_test_failures;                                                            \
+		}                                                                                 \
+	} while (0)
+
+static inline int test_result(const char* name) {
+	if (g_test_failures) {
+		std::fprintf(stderr, "[FAIL] %s: %d check(s) failed\n", name, g_test_failures);
+		return 1;
+	}
+	std::printf("[OK] %s\n", name);
+	return 0;
+}